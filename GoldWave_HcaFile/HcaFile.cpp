@@ -185,32 +185,44 @@ enum class CriFileType {
 
 Error DetectCriFile(const wchar_t* file, CriFileType* ftype = nullptr) {
   std::string file_s = utf16ToUTF8(file);
-  try {
-    cgss::CFileStream fileIn(file_s.c_str(), cgss::FileMode::OpenExisting, cgss::FileAccess::Read);
-    cgss::CHcaDecoderConfig decoderConfig;
-    decoderConfig.decodeFunc = cgss::CDefaultWaveGenerator::Decode16BitS;
-    decoderConfig.waveHeaderEnabled = FALSE;
-    cgss::CHcaDecoder hcaDecoder(&fileIn, decoderConfig);
-    HCA_INFO hcaInfo = hcaDecoder.GetHcaInfo();
-
+  // Only the headers are read, so this stays cheap when the host probes many files.
+  switch (cgss::CCriFormatProbe::Probe(file_s.c_str(), nullptr)) {
+  case cgss::CriFormat::Hca:
     if (ftype) {
       *ftype = CriFileType::Hca;
     }
     return eNone;
-  }
-  catch (...) {}
-  try {
-    cgss::CFileStream fileStream(file_s.c_str(), cgss::FileMode::OpenExisting, cgss::FileAccess::Read);
-    cgss::CAcbFile acb(&fileStream, file_s.c_str());
-
-    acb.Initialize();
+  case cgss::CriFormat::Utf:
     if (ftype) {
       *ftype = CriFileType::Acb;
     }
     return eNone;
+  default:
+    return eFormat;
+  }
+}
+
+// Track length in milliseconds, including looped repeats
+int32_t TrackDuration(const HCA_INFO& hcaInfo, uint32_t loopCount) {
+  int64 samples = int64(hcaInfo.blockCount) * 0x80 * 8;
+  if (hcaInfo.loopExists) {
+    int64 loopStart = int64(hcaInfo.loopStart) * 0x80 * 8 + hcaInfo.fmtR02; // fmtR02 is muteFooter
+    int64 loopEnd = int64(hcaInfo.loopEnd) * 0x80 * 8;
+    samples += (loopEnd - loopStart) * loopCount;
+  }
+  return int32_t(samples * 1000 / hcaInfo.samplingRate);
+}
+
+// Fills one duration per archive entry for the track picker (0 if it is not HCA).
+// Only the HCA headers are read, so this is fast regardless of archive size.
+int32_t GetTrackDurations(const cgss::CAfs2Archive& archive, uint32_t loopCount, int32_t* durations) {
+  const auto hcaInfos = archive.ReadHcaInfos(0);
+  int32_t j = 0;
+  for (auto& entry : archive.GetFiles()) {
+    auto info = hcaInfos.find(entry.first);
+    durations[j++] = info != hcaInfos.end() ? TrackDuration(info->second, loopCount) : 0;
   }
-  catch (...) {}
-  return eFormat;
+  return j;
 }
 
 //---------------------------------------------------------------------------
@@ -224,11 +236,11 @@ class HcaFile : public AudioFile
 {
   // Input data
   HcaFormat inFormat;     // Input file format
-  int64     length,       // Number of samples in file
-            memWavOffset, // Byte offset to start of audio
-            memWavSize;
+  int64     length;       // Number of samples in file
   FILE*     inFile;       // Input file
-  std::unique_ptr<uint8_t[]> memWavData;
+  std::unique_ptr<cgss::IStream> hcaStream;          // HCA data of the track
+  std::unique_ptr<cgss::CHcaDecoder> hcaDecoder;     // Decodes float samples on demand
+  std::unique_ptr<cgss::CReadAheadStream> wavStream; // Keeps decoding ahead on a background thread
 
   // Output data
   HcaFormat outFormat;    // Output file format
@@ -236,9 +248,7 @@ class HcaFile : public AudioFile
 public:
   HcaFile(void) {
     inFile = 0;
-    memWavData = 0;
-    memWavSize = 0;
-    length = memWavOffset = 0;
+    length = 0;
   }
 
   ~HcaFile(void) override {
@@ -279,9 +289,9 @@ Error gdecl HcaFile::Open(const wchar_t* name, const Format*) {
     return error;
 
   try {
-    std::unique_ptr<cgss::IStream> hcaStream;
     cgss::CHcaDecoderConfig decoderConfig;
-    decoderConfig.decodeFunc = cgss::CDefaultWaveGenerator::Decode16BitS;
+    // Float samples straight from the decoder, without going through 16-bit PCM.
+    decoderConfig.decodeFunc = cgss::CDefaultWaveGenerator::DecodeFloat;
     decoderConfig.waveHeaderEnabled = FALSE;
     if (ftype == CriFileType::Hca) {
       auto file_s = utf16ToUTF8(name);
@@ -289,7 +299,7 @@ Error gdecl HcaFile::Open(const wchar_t* name, const Format*) {
     }
     else if (ftype == CriFileType::Acb) {
       auto file_s = utf16ToUTF8(name);
-      cgss::CFileStream fileStream(file_s.c_str(), cgss::FileMode::OpenExisting, cgss::FileAccess::Read);
+      cgss::CMappedFileStream fileStream(file_s.c_str());
       cgss::CAcbFile acb(&fileStream, file_s.c_str());
 
       acb.Initialize();
@@ -307,71 +317,31 @@ Error gdecl HcaFile::Open(const wchar_t* name, const Format*) {
       if (totalCnt > 1) {
         int32_t j = 0;
         auto durations = std::make_unique<int32_t[]>(totalCnt);
-        if (intArchive) {
-          for (auto& entry : intArchive->GetFiles()) {
-            auto& record = entry.second;
-            auto hca = std::unique_ptr<cgss::CMemoryStream>(cgss::CAcbHelper::ExtractToNewStream(&fileStream, record.fileOffsetAligned, (uint32_t) record.fileSize));
-            const auto isHca = cgss::CHcaFormatReader::IsPossibleHcaStream(hca.get());
-            if (isHca) {
-              cgss::CHcaDecoder hcaDecoder(hca.get(), decoderConfig);
-              HCA_INFO hcaInfo = hcaDecoder.GetHcaInfo();
-              cgss::WaveSampleSection wavSmpl = { 's', 'm', 'p', 'l', 0x3C, 0, 0, 0, 0x3C, 0, 0, 0, 1, 0x18, 0, 0, 0, 0, 0, 0 };
-              wavSmpl.loopStart;
-              if (hcaInfo.loopExists) {
-                  wavSmpl.loopStart = hcaInfo.loopStart * 0x80 * 8 + hcaInfo.fmtR02; // fmtR02 is muteFooter
-                  wavSmpl.loopEnd = hcaInfo.loopEnd * 0x80 * 8;
-              }
-              durations[j++] = (2 * hcaInfo.channelCount) * (hcaInfo.blockCount * 0x80 * 8 +
-                  (wavSmpl.loopEnd - wavSmpl.loopStart) * decoderConfig.loopCount) / hcaInfo.channelCount / (16 / 8) * 1000 / hcaInfo.samplingRate;
-            }
-            else {
-              durations[j++] = 0;
-            }
-          }
-        }
-        if (extArchive) {
-          cgss::CFileStream fs(extArchive->GetFileName(), cgss::FileMode::OpenExisting, cgss::FileAccess::Read);
-          for (auto& entry : extArchive->GetFiles()) {
-            auto& record = entry.second;
-            auto hca = std::unique_ptr<cgss::CMemoryStream>(cgss::CAcbHelper::ExtractToNewStream(&fs, record.fileOffsetAligned, (uint32_t) record.fileSize));
-            const auto isHca = cgss::CHcaFormatReader::IsPossibleHcaStream(hca.get());
-            if (isHca) {
-              cgss::CHcaDecoder hcaDecoder(hca.get(), decoderConfig);
-              HCA_INFO hcaInfo = hcaDecoder.GetHcaInfo();
-              cgss::WaveSampleSection wavSmpl = { 's', 'm', 'p', 'l', 0x3C, 0, 0, 0, 0x3C, 0, 0, 0, 1, 0x18, 0, 0, 0, 0, 0, 0 };
-              wavSmpl.loopStart;
-              if (hcaInfo.loopExists) {
-                  wavSmpl.loopStart = hcaInfo.loopStart * 0x80 * 8 + hcaInfo.fmtR02; // fmtR02 is muteFooter
-                  wavSmpl.loopEnd = hcaInfo.loopEnd * 0x80 * 8;
-              }
-              durations[j++] = (2 * hcaInfo.channelCount) * (hcaInfo.blockCount * 0x80 * 8 +
-                  (wavSmpl.loopEnd - wavSmpl.loopStart) * decoderConfig.loopCount) / hcaInfo.channelCount / (16 / 8) * 1000 / hcaInfo.samplingRate;
-            }
-            else {
-              durations[j++] = 0;
-            }
-          }
-        }
+        if (intArchive)
+          j += GetTrackDurations(*intArchive, decoderConfig.loopCount, durations.get() + j);
+        if (extArchive)
+          j += GetTrackDurations(*extArchive, decoderConfig.loopCount, durations.get() + j);
         askTrackNo(&choice, totalCnt, durations.get());
       }
-      std::unique_ptr<cgss::CFileStream> extFileStream;
       cgss::CAfs2Archive* archive;
       bool isInternal = (uint32_t) choice <= internalCnt;
-      cgss::IStream* dataStream;
+      const char* dataFileName;
       if (isInternal) {
         archive = intArchive.get();
-        dataStream = &fileStream;
+        dataFileName = file_s.c_str();
       }
       else {
         archive = extArchive.get();
         choice -= internalCnt;
-        extFileStream = std::make_unique<cgss::CFileStream>(archive->GetFileName(), cgss::FileMode::OpenExisting, cgss::FileAccess::Read);
-        dataStream = extFileStream.get();
+        dataFileName = archive->GetFileName();
       }
       for (auto& entry : archive->GetFiles()) {
         if (i++ != choice) continue;
         auto& record = entry.second;
-        hcaStream.reset(cgss::CAcbHelper::ExtractToNewStream(dataStream, record.fileOffsetAligned, (uint32_t) record.fileSize));
+        // The track is read in place, through a file handle of its own that stays open until Close().
+        auto dataStream = std::make_unique<cgss::CFileStream>(dataFileName, cgss::FileMode::OpenExisting, cgss::FileAccess::Read);
+        hcaStream = std::make_unique<cgss::CSubStream>(dataStream.get(), record.fileOffsetAligned, record.fileSize, TRUE);
+        dataStream.release();
         const auto isHca = cgss::CHcaFormatReader::IsPossibleHcaStream(hcaStream.get());
         if (!isHca) {
           Ask(L"Track is not hca stream\n\nAborting", Asker::Ok, Asker::Ok);
@@ -396,28 +366,20 @@ Error gdecl HcaFile::Open(const wchar_t* name, const Format*) {
     SavedCriKey.k2 = k2;
     decoderConfig.cipherConfig.keyParts.key1 = k1;
     decoderConfig.cipherConfig.keyParts.key2 = k2;
-    cgss::CHcaDecoder hcaDecoder(hcaStream.get(), decoderConfig);
-    auto hcaInfo = hcaDecoder.GetHcaInfo();
+    hcaDecoder = std::make_unique<cgss::CHcaDecoder>(hcaStream.get(), decoderConfig);
+    auto hcaInfo = hcaDecoder->GetHcaInfo();
     inFormat.bits = 16;
     inFormat.channels = hcaInfo.channelCount;
     inFormat.rate = hcaInfo.samplingRate;
-    auto len = hcaDecoder.GetLength();
-    memWavData = std::make_unique<uint8_t[]>(size_t(len));
-    cgss::CMemoryStream memStream(memWavData.get(), len);
-    uint32_t read = 1;
-    constexpr uint32_t bufferSize = 1024;
-    uint8_t buffer[bufferSize];
-    while (read) {
-      read = hcaDecoder.Read(buffer, bufferSize, 0, bufferSize);
-      if (read) {
-        memStream.Write(buffer, bufferSize, 0, read);
-      }
-    }
-    length = len / ((uint64_t) inFormat.channels * 2);
-    memWavOffset = 0;
-    memWavSize = len;
+    length = int64(hcaInfo.blockCount) * 0x80 * 8;
+    // Nothing is decoded here; blocks are decoded as the host reads them.
+    wavStream = std::make_unique<cgss::CReadAheadStream>(hcaDecoder.get(), 0);
   }
   catch (...) {
+    wavStream.reset();
+    hcaDecoder.reset();
+    hcaStream.reset();
+    length = 0;
     error = eFormat;
   }
 
@@ -433,7 +395,7 @@ Error gdecl HcaFile::Open(const wchar_t* name, const Format*) {
     }
     else if (ftype == CriFileType::Acb) {
       std::string file_s = utf16ToUTF8(name);
-      cgss::CFileStream fileStream(file_s.c_str(), cgss::FileMode::OpenExisting, cgss::FileAccess::Read);
+      cgss::CMappedFileStream fileStream(file_s.c_str());
       cgss::CAcbFile acb(&fileStream, file_s.c_str());
 
       acb.Initialize();
@@ -453,53 +415,10 @@ Error gdecl HcaFile::Open(const wchar_t* name, const Format*) {
       if (totalCnt > 1) {
         int32_t j = 0;
         auto durations = std::make_unique<int32_t[]>(totalCnt * 4);
-        if (intArchive) {
-          for (auto& entry : intArchive->GetFiles()) {
-            auto& record = entry.second;
-            auto hca = std::unique_ptr<cgss::CMemoryStream>(cgss::CAcbHelper::ExtractToNewStream(&fileStream, record.fileOffsetAligned, (uint32_t) record.fileSize));
-            const auto isHca = cgss::CHcaFormatReader::IsPossibleHcaStream(hca.get());
-            if (isHca) {
-              cgss::CHcaDecoder hcaDecoder(hca.get(), decoderConfig);
-              HCA_INFO hcaInfo = hcaDecoder.GetHcaInfo();
-              WaveSampleSection wavSmpl = {'s', 'm', 'p', 'l', 0x3C, 0, 0, 0, 0x3C, 0, 0, 0, 1, 0x18, 0, 0, 0, 0, 0, 0};
-              wavSmpl.loopStart;
-              if (hcaInfo.loopExists) {
-                wavSmpl.loopStart = hcaInfo.loopStart * 0x80 * 8 + hcaInfo.fmtR02; // fmtR02 is muteFooter
-                wavSmpl.loopEnd = hcaInfo.loopEnd * 0x80 * 8;
-              }
-              int32_t len = (2 * hcaInfo.channelCount) * (hcaInfo.blockCount * 0x80 * 8 +
-                (wavSmpl.loopEnd - wavSmpl.loopStart) * decoderConfig.loopCount) / hcaInfo.channelCount / (16 / 8) * 1000 / hcaInfo.samplingRate;
-              durations[j++] = len;
-            }
-            else {
-              durations[j++] = 0;
-            }
-          }
-        }
-        if (extArchive) {
-          cgss::CFileStream fs(extArchive->GetFileName(), cgss::FileMode::OpenExisting, cgss::FileAccess::Read);
-          for (auto& entry : extArchive->GetFiles()) {
-            auto& record = entry.second;
-            auto hca = std::unique_ptr<cgss::CMemoryStream>(cgss::CAcbHelper::ExtractToNewStream(&fs, record.fileOffsetAligned, (uint32_t) record.fileSize));
-            const auto isHca = cgss::CHcaFormatReader::IsPossibleHcaStream(hca.get());
-            if (isHca) {
-              cgss::CHcaDecoder hcaDecoder(hca.get(), decoderConfig);
-              HCA_INFO hcaInfo = hcaDecoder.GetHcaInfo();
-              WaveSampleSection wavSmpl = {'s', 'm', 'p', 'l', 0x3C, 0, 0, 0, 0x3C, 0, 0, 0, 1, 0x18, 0, 0, 0, 0, 0, 0};
-              wavSmpl.loopStart;
-              if (hcaInfo.loopExists) {
-                wavSmpl.loopStart = hcaInfo.loopStart * 0x80 * 8 + hcaInfo.fmtR02; // fmtR02 is muteFooter
-                wavSmpl.loopEnd = hcaInfo.loopEnd * 0x80 * 8;
-              }
-              int32_t len = (2 * hcaInfo.channelCount) * (hcaInfo.blockCount * 0x80 * 8 +
-                (wavSmpl.loopEnd - wavSmpl.loopStart) * decoderConfig.loopCount) / hcaInfo.channelCount / (16 / 8) * 1000 / hcaInfo.samplingRate;
-              durations[j++] = len;
-            }
-            else {
-              durations[j++] = 0;
-            }
-          }
-        }
+        if (intArchive)
+          j += GetTrackDurations(*intArchive, decoderConfig.loopCount, durations.get() + j);
+        if (extArchive)
+          j += GetTrackDurations(*extArchive, decoderConfig.loopCount, durations.get() + j);
         askTrackNo(&choice, totalCnt, durations.get());
       }
       if (choice > totalCnt) {
@@ -588,49 +507,45 @@ Error gdecl HcaFile::Open(const wchar_t* name, const Format*) {
 
 // Read audio data from file and convert to native 'audio' type
 int gdecl HcaFile::Read(audio* dest, int samples) {
-  if (!memWavData)
+  if (!wavStream)
     return -eForbidden;
 
-  auto ptr = memWavData.get() + memWavOffset;
+  static_assert(sizeof(audio) == sizeof(float), "The decoder writes 32-bit float samples");
+  const uint32_t frameSize = uint32_t(sizeof(audio) * inFormat.channels);
+  const uint32_t bufferSize = uint32_t(samples) * frameSize;
 
-  int total = 0;
-  while (samples--) {
-    if (memWavOffset + (int64) inFormat.channels * 2 > memWavSize)
-      break;
-    for (auto i = 0; i < inFormat.channels; ++i, ptr += 2, memWavOffset += 2) {
-      auto val = uint16_t(ptr[0]) | uint16_t(ptr[1]) << 8;
-      *dest++ = (float) int16_t(val) / 0x7fff;
-    }
-    total++;
+  try {
+    return int(wavStream->Read(dest, bufferSize, 0, bufferSize) / frameSize);
+  }
+  catch (...) {
+    return -eFormat;
   }
-  return total;
 }
 
 // Seek to sample position within the input stream
 Error gdecl HcaFile::Seek(int64 position) {
   // Seek only applies to input.  If an input file is not open, return error
-  if (!memWavData)
+  if (!wavStream)
     return eForbidden;
 
-  // Convert samples to bytes
-  position *= inFormat.channels * 2;
-
-  // Note: limited to 2GB on 32-bit systems
-  if (position >= memWavSize)
+  if (position >= length)
     return eSeek;
-  
-  memWavOffset = position;
+
+  // Cheap: decoding restarts one block before the position, on the background thread.
+  wavStream->SetPosition(uint64_t(position) * sizeof(audio) * inFormat.channels);
 
   return eNone;
 }
 
 // Close input file
 Error gdecl HcaFile::Close(void) {
-  if (!memWavData)
+  if (!hcaStream)
     return eForbidden;
-  memWavData.reset();
+  // Stop the background thread before the decoder and its stream go away.
+  wavStream.reset();
+  hcaDecoder.reset();
+  hcaStream.reset();
   length = 0;
-  memWavOffset = 0;
 
   // Reset format to default
   inFormat = HcaFormat();
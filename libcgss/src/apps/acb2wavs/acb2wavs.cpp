@@ -4,6 +4,11 @@
 #include <iostream>
 #include <string>
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 using namespace cgss;
 using namespace std;
@@ -11,8 +16,14 @@ using namespace std;
 struct Options {
     HCA_DECODER_CONFIG decoderConfig;
     bool_t useCueName;
+    // 1 decodes on the calling thread; more runs the pipeline in ProcessAllBinariesParallel().
+    uint32_t threadCount;
+    // Maximum total size of the extracted entries held in memory by the pipeline, in MiB.
+    uint32_t memoryLimit;
 };
 
+static const uint32_t DefaultMemoryLimit = 256;
+
 void PrintHelp();
 
 int ParseArgs(int argc, const char *argv[], const char **input, Options &options);
@@ -21,6 +32,10 @@ int DoWork(const string &inputFile, const Options &options);
 
 int ProcessAllBinaries(CAcbFile *acb, uint32_t formatVersion, const Options &options, const string &extractDir, CAfs2Archive *archive, IStream *dataStream, bool_t isInternal);
 
+int ProcessAllBinariesParallel(CAcbFile *acb, const HCA_DECODER_CONFIG &decoderConfig, const Options &options, const string &extractDir, CAfs2Archive *archive, IStream *dataStream, const char *afsSource);
+
+string GetExtractFileName(CAcbFile *acb, const AFS2_FILE_RECORD &record, const Options &options);
+
 int DecodeHca(IStream *hcaDataStream, IStream *waveStream, const HCA_DECODER_CONFIG &dc);
 
 template<typename T>
@@ -53,8 +68,10 @@ int main(int argc, const char *argv[]) {
 
 void PrintHelp() {
     cout << "Usage:\n" << endl;
-    cout << "acb2wavs <acb file> [-a <key1> -b <key2>] [-n]" << endl << endl;
+    cout << "acb2wavs <acb file> [-a <key1> -b <key2>] [-n] [-j <threads>] [-m <memory limit>]" << endl << endl;
     cout << "\t-n\tUse cue names for output waveforms" << endl;
+    cout << "\t-j\tDecode on this many threads (0: all hardware threads; default: 1)" << endl;
+    cout << "\t-m\tMaximum size of extracted files kept in memory with -j, in MiB (default: " << DefaultMemoryLimit << ")" << endl;
 }
 
 int ParseArgs(int argc, const char *argv[], const char **input, Options &options) {
@@ -70,6 +87,9 @@ int ParseArgs(int argc, const char *argv[], const char **input, Options &options
 
     options.decoderConfig.cipherConfig.keyModifier = 0;
 
+    options.threadCount = 1;
+    options.memoryLimit = DefaultMemoryLimit;
+
     for (int i = 2; i < argc; ++i) {
         if (argv[i][0] == '-' || argv[i][0] == '/') {
             switch (argv[i][1]) {
@@ -86,6 +106,18 @@ int ParseArgs(int argc, const char *argv[], const char **input, Options &options
                 case 'n':
                     options.useCueName = TRUE;
                     break;
+                case 'j':
+                    if (i + 1 < argc) {
+                        const auto threadCount = atoi(argv[++i]);
+                        options.threadCount = threadCount > 0 ? static_cast<uint32_t>(threadCount) : CParallel::GetDefaultThreadCount();
+                    }
+                    break;
+                case 'm':
+                    if (i + 1 < argc) {
+                        const auto memoryLimit = atoi(argv[++i]);
+                        options.memoryLimit = memoryLimit > 0 ? static_cast<uint32_t>(memoryLimit) : DefaultMemoryLimit;
+                    }
+                    break;
                 default:
                     return 2;
             }
@@ -98,7 +130,7 @@ int ParseArgs(int argc, const char *argv[], const char **input, Options &options
 int DoWork(const string &inputFile, const Options &options) {
     const auto baseExtractDirPath = CPath::Combine(CPath::GetDirectoryName(inputFile), "_acb_" + CPath::GetFileName(inputFile));
 
-    CFileStream fileStream(inputFile.c_str(), FileMode::OpenExisting, FileAccess::Read);
+    CMappedFileStream fileStream(inputFile.c_str());
     CAcbFile acb(&fileStream, inputFile.c_str());
 
     acb.Initialize();
@@ -177,21 +209,15 @@ int ProcessAllBinaries(CAcbFile *acb, uint32_t formatVersion, const Options &opt
         decoderConfig.cipherConfig.keyModifier = 0;
     }
 
+    if (options.threadCount > 1) {
+        return ProcessAllBinariesParallel(acb, decoderConfig, options, extractDir, archive, dataStream, afsSource);
+    }
+
     for (auto &entry : archive->GetFiles()) {
         auto &record = entry.second;
-        std::string extractFileName;
-
-        if (options.useCueName) {
-            extractFileName = acb->GetCueNameFromCueId(record.cueId);
-            extractFileName = ReplaceExtension(extractFileName, ".hca", ".wav");
-        } else {
-            extractFileName = CAcbFile::GetSymbolicFileNameFromCueId(record.cueId);
-            extractFileName = ReplaceExtension(extractFileName, ".bin", ".wav");
-        }
-
-        auto extractFilePath = CPath::Combine(extractDir, extractFileName);
+        const auto extractFilePath = CPath::Combine(extractDir, GetExtractFileName(acb, record, options));
 
-        auto fileData = CAcbHelper::ExtractToNewStream(dataStream, record.fileOffsetAligned, (uint32_t)record.fileSize);
+        auto fileData = new CSubStream(dataStream, record.fileOffsetAligned, record.fileSize);
 
         const auto isHca = CHcaFormatReader::IsPossibleHcaStream(fileData);
 
@@ -227,20 +253,216 @@ int ProcessAllBinaries(CAcbFile *acb, uint32_t formatVersion, const Options &opt
     return 0;
 }
 
-int DecodeHca(IStream *hcaDataStream, IStream *waveStream, const HCA_DECODER_CONFIG &dc) {
-    CHcaDecoder decoder(hcaDataStream, dc);
-    static const int bufferSize = 10240;
-    uint8_t buffer[bufferSize];
-    uint32_t read = 1;
+// One entry on its way through the pipeline of ProcessAllBinariesParallel().
+struct PipelineEntry {
+    const AFS2_FILE_RECORD *record;
+    string extractFilePath;
+    // Extracted file, or nullptr if it is not an HCA file. Counted against the memory limit until it is decoded.
+    CMemoryStream *fileData;
+    // What happened to the entry, printed after its "Processing" line.
+    string result;
+    bool_t isDecoded;
+};
 
-    while (read > 0) {
-        read = decoder.Read(buffer, bufferSize, 0, bufferSize);
+// Entries move from the reader (the calling thread) to the decoder threads through a queue. Decoders write the waves
+// straight to their files; the reporter thread then prints the results in archive order. An entry's extracted data is
+// held from extraction until it is decoded, and the entry stays in flight until it is reported. The number of entries
+// in flight and the total extracted size held are bounded, so the reader waits when the decoders or the reporter fall behind.
+int ProcessAllBinariesParallel(CAcbFile *acb, const HCA_DECODER_CONFIG &decoderConfig, const Options &options, const string &extractDir, CAfs2Archive *archive, IStream *dataStream, const char *afsSource) {
+    const auto &files = archive->GetFiles();
+    const auto entryCount = static_cast<uint32_t>(files.size());
+    const auto decoderCount = options.threadCount;
+    const auto maxEntriesInFlight = decoderCount * 2;
+    const auto memoryLimit = static_cast<uint64_t>(options.memoryLimit) * 1024 * 1024;
+
+    vector<PipelineEntry> entries(entryCount);
+    uint32_t index = 0;
+
+    for (auto &entry : files) {
+        auto &pipelineEntry = entries[index++];
+
+        pipelineEntry.record = &entry.second;
+        pipelineEntry.extractFilePath = CPath::Combine(extractDir, GetExtractFileName(acb, entry.second, options));
+        pipelineEntry.fileData = nullptr;
+        pipelineEntry.isDecoded = FALSE;
+    }
 
-        if (read > 0) {
-            waveStream->Write(buffer, bufferSize, 0, read);
+    mutex m;
+    // Signaled when an entry is queued for decoding or the reader finishes.
+    condition_variable entryQueued;
+    // Signaled when an entry is decoded.
+    condition_variable entryDecoded;
+    // Signaled when an entry's extracted data is freed or the entry is reported.
+    condition_variable entryReleased;
+    deque<uint32_t> decodeQueue;
+    uint32_t readCount = 0, reportedCount = 0;
+    uint64_t bytesInFlight = 0;
+    bool_t isReadingFinished = FALSE;
+
+    auto decode = [&]() {
+        while (true) {
+            uint32_t i;
+
+            {
+                unique_lock<mutex> lock(m);
+                entryQueued.wait(lock, [&]() { return !decodeQueue.empty() || isReadingFinished; });
+
+                if (decodeQueue.empty()) {
+                    return;
+                }
+
+                i = decodeQueue.front();
+                decodeQueue.pop_front();
+            }
+
+            auto &entry = entries[i];
+            uint64_t fileSize = 0;
+
+            if (entry.fileData) {
+                try {
+                    CFileStream fs(entry.extractFilePath.c_str(), FileMode::Create, FileAccess::Write);
+
+                    DecodeHca(entry.fileData, &fs, decoderConfig);
+
+                    entry.result = "decoded";
+                } catch (CException &ex) {
+                    if (CFileSystem::FileExists(entry.extractFilePath)) {
+                        CFileSystem::RmFile(entry.extractFilePath);
+                    }
+
+                    char buffer[32];
+                    sprintf(buffer, " (%d)", ex.GetOpResult());
+                    entry.result = "errored: " + ex.GetExceptionMessage() + buffer;
+                }
+
+                fileSize = entry.fileData->GetLength();
+                delete entry.fileData;
+                entry.fileData = nullptr;
+            } else {
+                entry.result = "skipped (not HCA)";
+            }
+
+            {
+                lock_guard<mutex> lock(m);
+                entry.isDecoded = TRUE;
+                bytesInFlight -= fileSize;
+            }
+
+            entryDecoded.notify_all();
+            entryReleased.notify_all();
         }
+    };
+
+    auto report = [&]() {
+        for (uint32_t i = 0; i < entryCount; ++i) {
+            auto &entry = entries[i];
+
+            {
+                unique_lock<mutex> lock(m);
+                entryDecoded.wait(lock, [&]() { return entry.isDecoded || (isReadingFinished && i >= readCount); });
+
+                if (!entry.isDecoded) {
+                    return;
+                }
+            }
+
+            const auto &record = *entry.record;
+
+            fprintf(stdout, "Processing %s AFS: #%u (offset=%u, size=%u)...   %s\n", afsSource, (uint32_t)record.cueId, (uint32_t)record.fileOffsetAligned, (uint32_t)record.fileSize,
+                    entry.result.c_str());
+
+            {
+                lock_guard<mutex> lock(m);
+                ++reportedCount;
+            }
+
+            entryReleased.notify_all();
+        }
+    };
+
+    vector<thread> threads;
+    threads.reserve(decoderCount + 1);
+
+    for (uint32_t i = 0; i < decoderCount; ++i) {
+        threads.emplace_back(decode);
+    }
+
+    threads.emplace_back(report);
+
+    int r = 0;
+
+    try {
+        for (uint32_t i = 0; i < entryCount; ++i) {
+            auto &entry = entries[i];
+            const auto &record = *entry.record;
+            CSubStream fileStream(dataStream, record.fileOffsetAligned, record.fileSize);
+            const auto fileSize = CHcaFormatReader::IsPossibleHcaStream(&fileStream) ? record.fileSize : 0;
+
+            {
+                // A file larger than the limit is still read, once nothing else is held.
+                unique_lock<mutex> lock(m);
+                entryReleased.wait(lock, [&]() {
+                    return i - reportedCount < maxEntriesInFlight && (bytesInFlight == 0 || bytesInFlight + fileSize <= memoryLimit);
+                });
+
+                bytesInFlight += fileSize;
+            }
+
+            if (fileSize > 0) {
+                entry.fileData = CAcbHelper::ExtractToNewStream(&fileStream, 0, static_cast<uint32_t>(fileSize));
+            }
+
+            {
+                lock_guard<mutex> lock(m);
+                decodeQueue.push_back(i);
+                readCount = i + 1;
+            }
+
+            entryQueued.notify_one();
+        }
+    } catch (CException &ex) {
+        fprintf(stderr, "%s (%d)\n", ex.GetExceptionMessage().c_str(), ex.GetOpResult());
+        r = -1;
+    }
+
+    {
+        lock_guard<mutex> lock(m);
+        isReadingFinished = TRUE;
+    }
+
+    entryQueued.notify_all();
+    entryDecoded.notify_all();
+
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    for (auto &entry : entries) {
+        delete entry.fileData;
+    }
+
+    return r;
+}
+
+string GetExtractFileName(CAcbFile *acb, const AFS2_FILE_RECORD &record, const Options &options) {
+    std::string extractFileName;
+
+    if (options.useCueName) {
+        extractFileName = acb->GetCueNameFromCueId(record.cueId);
+        extractFileName = ReplaceExtension(extractFileName, ".hca", ".wav");
+    } else {
+        extractFileName = CAcbFile::GetSymbolicFileNameFromCueId(record.cueId);
+        extractFileName = ReplaceExtension(extractFileName, ".bin", ".wav");
     }
 
+    return extractFileName;
+}
+
+int DecodeHca(IStream *hcaDataStream, IStream *waveStream, const HCA_DECODER_CONFIG &dc) {
+    CHcaDecoder decoder(hcaDataStream, dc);
+
+    decoder.DecodeTo(waveStream);
+
     return 0;
 }
 
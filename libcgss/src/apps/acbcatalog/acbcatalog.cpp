@@ -0,0 +1,130 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../../lib/cgss_api.h"
+
+using namespace cgss;
+using namespace std;
+
+void PrintHelp();
+
+int BuildCatalog(const char *directory, const char *catalogFileName, uint32_t threadCount);
+
+int FindInCatalog(const char *catalogFileName, char mode, const char *key);
+
+void PrintEntry(const CAcbCatalog &catalog, const ACB_CATALOG_ENTRY &entry);
+
+const char *GetEncodeTypeName(uint32_t encodeType);
+
+int main(int argc, const char *argv[]) {
+    if (argc < 4) {
+        PrintHelp();
+        return 0;
+    }
+
+    try {
+        if (strcmp(argv[1], "build") == 0) {
+            uint32_t threadCount = 0;
+
+            if (argc >= 6 && strcmp(argv[4], "-j") == 0) {
+                const auto n = atoi(argv[5]);
+                threadCount = n > 0 ? static_cast<uint32_t>(n) : 0;
+            }
+
+            return BuildCatalog(argv[2], argv[3], threadCount);
+        }
+
+        if (strcmp(argv[1], "find") == 0 && argc >= 5 && argv[3][0] == '-' && (argv[3][1] == 'n' || argv[3][1] == 'c' || argv[3][1] == 'w')) {
+            return FindInCatalog(argv[2], argv[3][1], argv[4]);
+        }
+    } catch (const CException &ex) {
+        cerr << "CException: " << ex.GetExceptionMessage() << ", code=" << ex.GetOpResult() << endl;
+        return ex.GetOpResult();
+    }
+
+    PrintHelp();
+
+    return 2;
+}
+
+void PrintHelp() {
+    cout << "acbcatalog: catalog of the waveforms in a directory tree of ACB/AWB files" << endl << endl;
+    cout << "Usage:" << endl;
+    cout << "  acbcatalog build <directory> <catalog file> [-j <threads>]" << endl;
+    cout << "  acbcatalog find <catalog file> -n <cue name>" << endl;
+    cout << "  acbcatalog find <catalog file> -c <cue ID>" << endl;
+    cout << "  acbcatalog find <catalog file> -w <waveform ID>" << endl << endl;
+    cout << "\t-j\tScan files on this many threads (default: all hardware threads)" << endl;
+}
+
+int BuildCatalog(const char *directory, const char *catalogFileName, uint32_t threadCount) {
+    vector<string> skippedFiles;
+    const auto entryCount = CAcbCatalog::Build(directory, catalogFileName, threadCount, &skippedFiles);
+
+    for (auto &skippedFile : skippedFiles) {
+        cerr << "Skipped " << skippedFile << endl;
+    }
+
+    cout << entryCount << " waveforms written to " << catalogFileName << endl;
+
+    return 0;
+}
+
+int FindInCatalog(const char *catalogFileName, char mode, const char *key) {
+    CAcbCatalog catalog(catalogFileName);
+    vector<const ACB_CATALOG_ENTRY *> entries;
+
+    switch (mode) {
+        case 'n':
+            entries = catalog.FindByCueName(key);
+            break;
+        case 'c':
+            entries = catalog.FindByCueId(static_cast<uint32_t>(strtoul(key, nullptr, 0)));
+            break;
+        default:
+            entries = catalog.FindByWaveformId(static_cast<uint32_t>(strtoul(key, nullptr, 0)));
+            break;
+    }
+
+    for (auto entry : entries) {
+        PrintEntry(catalog, *entry);
+    }
+
+    return entries.empty() ? 1 : 0;
+}
+
+void PrintEntry(const CAcbCatalog &catalog, const ACB_CATALOG_ENTRY &entry) {
+    cout << catalog.GetContainerPath(entry) << ": cue #" << entry.cueId << " '" << catalog.GetCueName(entry) << "'"
+         << ", waveform #" << entry.waveformId << ", offset=" << entry.offset << ", size=" << entry.size
+         << ", " << GetEncodeTypeName(entry.encodeType);
+
+    if (entry.samplingRate > 0) {
+        cout << ", " << entry.channelCount << "ch, " << entry.samplingRate << "Hz, "
+             << static_cast<double>(entry.sampleCount) / entry.samplingRate << "s";
+    }
+
+    if (entry.loopExists) {
+        cout << ", loop=" << entry.loopStart << "-" << entry.loopEnd;
+    }
+
+    cout << endl;
+}
+
+const char *GetEncodeTypeName(uint32_t encodeType) {
+    switch (encodeType) {
+        case CGSS_ACB_WAVEFORM_ADX:
+            return "ADX";
+        case CGSS_ACB_WAVEFORM_HCA:
+            return "HCA";
+        case CGSS_ACB_WAVEFORM_VAG:
+            return "VAG";
+        case CGSS_ACB_WAVEFORM_ATRAC3:
+            return "ATRAC3";
+        case CGSS_ACB_WAVEFORM_BCWAV:
+            return "BCWAV";
+        case CGSS_ACB_WAVEFORM_NINTENDO_DSP:
+            return "DSP";
+        default:
+            return "unknown";
+    }
+}
@@ -40,7 +40,7 @@ int main(int argc, const char *argv[]) {
         return -1;
     }
 
-    CFileStream fileStream(filePath, FileMode::OpenExisting, FileAccess::Read);
+    CMappedFileStream fileStream(filePath);
     CAcbFile acb(&fileStream, filePath);
 
     acb.Initialize();
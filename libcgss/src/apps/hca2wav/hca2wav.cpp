@@ -62,17 +62,7 @@ int main(int argc, const char *argv[]) {
             fileOut(argv0[2], cgss::FileMode::Create, cgss::FileAccess::Write);
         cgss::CHcaDecoder hcaDecoder(&fileIn, decoderConfig);
 
-        uint32_t read = 1;
-        static const uint32_t bufferSize = 1024;
-        uint8_t buffer[bufferSize];
-
-        while (read > 0) {
-            read = hcaDecoder.Read(buffer, bufferSize, 0, bufferSize);
-
-            if (read > 0) {
-                fileOut.Write(buffer, bufferSize, 0, read);
-            }
-        }
+        hcaDecoder.DecodeTo(&fileOut);
     } catch (const cgss::CException &ex) {
         cerr << "CException: " << ex.GetExceptionMessage() << ", code=" << ex.GetOpResult() << endl;
         return ex.GetOpResult();
@@ -0,0 +1,117 @@
+// Compares the HCA block bit reader against the previous (byte-by-byte) implementation by decoding a whole file
+// with each and comparing the output.
+// It switches the decoder's internal bit reader, so it must be linked against the static library.
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include "../../lib/cgss_api.h"
+#include "../../lib/kawashima/hca/CHcaDecoder_vgmstream.h"
+
+using namespace std;
+
+void PrintHelp();
+
+static double Decode(const char *fileName, const HCA_DECODER_CONFIG &decoderConfig, vector<uint8_t> &output);
+
+int main(int argc, const char *argv[]) {
+    if (argc < 2) {
+        PrintHelp();
+        return 0;
+    }
+
+    cgss::CHcaDecoderConfig decoderConfig;
+    decoderConfig.decodeFunc = cgss::CDefaultWaveGenerator::Decode16BitS;
+    decoderConfig.waveHeaderEnabled = FALSE;
+
+    const char *fileName = nullptr;
+    auto rounds = 5;
+
+    for (auto i = 1; i < argc; ++i) {
+        if (argv[i][0] == '-' && argv[i][1] != '\0' && argv[i][2] == '\0') {
+            switch (argv[i][1]) {
+                case 'a':
+                    if (i + 1 < argc) {
+                        decoderConfig.cipherConfig.keyParts.key1 = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 16));
+                    }
+                    break;
+                case 'b':
+                    if (i + 1 < argc) {
+                        decoderConfig.cipherConfig.keyParts.key2 = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 16));
+                    }
+                    break;
+                case 'r':
+                    if (i + 1 < argc) {
+                        rounds = atoi(argv[++i]);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        } else if (!fileName) {
+            fileName = argv[i];
+        }
+    }
+
+    if (!fileName || rounds < 1) {
+        PrintHelp();
+        return 2;
+    }
+
+    try {
+        vector<uint8_t> legacyOutput, currentOutput;
+        double legacyTime = 0, currentTime = 0;
+
+        for (auto round = 0; round < rounds; ++round) {
+            bitreader_use_legacy(TRUE);
+            legacyTime += Decode(fileName, decoderConfig, legacyOutput);
+            bitreader_use_legacy(FALSE);
+            currentTime += Decode(fileName, decoderConfig, currentOutput);
+        }
+
+        cout << "Decoded " << currentOutput.size() << " bytes, " << rounds << " rounds" << endl;
+        cout << "  Previous reader: " << legacyTime << " ms" << endl;
+        cout << "  Current reader: " << currentTime << " ms" << endl;
+
+        if (legacyOutput != currentOutput) {
+            uint64_t offset = 0;
+
+            while (offset < legacyOutput.size() && offset < currentOutput.size() && legacyOutput[offset] == currentOutput[offset]) {
+                ++offset;
+            }
+
+            cerr << "Decoded output differs at byte " << offset << "." << endl;
+            return 1;
+        }
+    } catch (const cgss::CException &ex) {
+        cerr << "CException: " << ex.GetExceptionMessage() << ", code=" << ex.GetOpResult() << endl;
+        return ex.GetOpResult();
+    }
+    return 0;
+}
+
+void PrintHelp() {
+    cout << "hcabitbench: HCA bit reader benchmark" << endl << endl;
+    cout << "Usage:" << endl;
+    cout << "  hcabitbench <input HCA> [-a <key1>] [-b <key2>] [-r <rounds>]" << endl << endl;
+    cout << "\t-a\tDecryption key 1 (hex)" << endl;
+    cout << "\t-b\tDecryption key 2 (hex)" << endl;
+    cout << "\t-r\tNumber of decodes with each reader (default: 5)" << endl;
+}
+
+// Decodes the whole file on one thread and returns the time taken, in milliseconds.
+static double Decode(const char *fileName, const HCA_DECODER_CONFIG &decoderConfig, vector<uint8_t> &output) {
+    cgss::CFileStream fileStream(fileName, cgss::FileMode::OpenExisting, cgss::FileAccess::Read);
+    cgss::CHcaDecoder decoder(&fileStream, decoderConfig);
+
+    output.clear();
+    output.reserve(static_cast<size_t>(decoder.GetLength()));
+
+    const auto start = chrono::steady_clock::now();
+
+    decoder.DecodeTo([&output](const uint8_t *data, uint32_t size) {
+        output.insert(output.end(), data, data + size);
+    });
+
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
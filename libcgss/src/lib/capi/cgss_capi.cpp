@@ -456,26 +456,29 @@ CGSS_API_IMPL(CGSS_OP_RESULT) cgssUtfReadTable(CGSS_HANDLE stream, uint64_t offs
 
     strncpy(utfTable->tableName, tableCppObject->GetName(), UTF_TABLE_MAX_NAME_LEN);
 
-    const auto &rows = tableCppObject->GetRows();
+    const auto rowCount = tableCppObject->GetRowCount();
+    const auto columnCount = tableCppObject->GetColumnCount();
     utfTable->rows = new UTF_ROW[utfTable->header.rowCount];
 
     std::vector<UTF_FIELD> fieldList;
+    CUtfField field;
 
-    uint32_t i = 0;
-    for (auto &row : rows) {
+    for (uint32_t i = 0; i < rowCount; ++i) {
         auto &utfRow = utfTable->rows[i];
         fieldList.clear();
 
+        utfRow.baseOffset = utfTable->header.perRowDataOffset + utfTable->header.rowSize * i;
+
         if (utfTable->header.fieldCount > 0) {
             utfRow.fields = new UTF_FIELD[utfTable->header.fieldCount];
         } else {
             utfRow.fields = nullptr;
         }
 
-        auto j = 0;
-        for (const auto pField : row.fields) {
-            copy_utf_field(utfRow.fields + j, pField);
-            ++j;
+        uint32_t j;
+        for (j = 0; j < columnCount; ++j) {
+            tableCppObject->GetField(i, j, field);
+            copy_utf_field(utfRow.fields + j, &field);
         }
 
         /*
@@ -497,8 +500,6 @@ CGSS_API_IMPL(CGSS_OP_RESULT) cgssUtfReadTable(CGSS_HANDLE stream, uint64_t offs
             utfRow.fields[j] = fieldList[j];
         }
          */
-
-        ++i;
     }
 
     delete tableCppObject;
@@ -538,10 +539,10 @@ CGSS_API_IMPL(CGSS_OP_RESULT) cgssUtfFreeTable(UTF_TABLE *table) {
             }
         }
 
-        delete row.fields;
+        delete[] row.fields;
     }
 
-    delete (table->rows);
+    delete[] table->rows;
 
     memset(table, 0, sizeof(UTF_TABLE));
 
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "../cgss_env.h"
+
+#define ACB_CATALOG_UNKNOWN_ENCODE_TYPE (0xffffffffu)
+
+/**
+ * A waveform in a catalog built by CAcbCatalog. Catalog files hold these records as they are, so the layout is fixed.
+ */
+struct ACB_CATALOG_ENTRY {
+
+    /**
+     * Offset of the waveform in its container file.
+     */
+    uint64_t offset;
+    /**
+     * Size of the waveform, in bytes.
+     */
+    uint64_t size;
+    /**
+     * Length of the waveform in samples (per channel), without loops. 0 if it is not an HCA file.
+     */
+    uint64_t sampleCount;
+    /**
+     * Offsets of the cue name and the container path in the string pool of the catalog.
+     */
+    uint32_t cueNameOffset;
+    uint32_t containerPathOffset;
+    /**
+     * Cue ID in the ACB. For a standalone AWB, the same as waveformId.
+     */
+    uint32_t cueId;
+    /**
+     * ID of the waveform in its AWB.
+     */
+    uint32_t waveformId;
+    /**
+     * Codec, one of CGSS_ACB_WAVEFORM_ENCODE_TYPE, or ACB_CATALOG_UNKNOWN_ENCODE_TYPE for a file in a standalone AWB that is not an HCA file.
+     */
+    uint32_t encodeType;
+    uint32_t channelCount;
+    /**
+     * Sampling rate, in hertz.
+     */
+    uint32_t samplingRate;
+    /**
+     * Loop start and end, in samples. Only meaningful if loopExists is set.
+     */
+    uint32_t loopStart;
+    uint32_t loopEnd;
+    uint8_t loopExists;
+    /**
+     * Whether the container is an AWB file (an external AWB of an ACB, or a standalone AWB) rather than an ACB file.
+     */
+    uint8_t isStreaming;
+    uint8_t reserved[2];
+
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../cgss_env.h"
+#include "../cgss_cenum.h"
 #include "HCA_CIPHER_CONFIG.h"
 
 #ifdef __cplusplus
@@ -19,6 +20,11 @@ typedef struct _HCA_DECODER_CONFIG {
     bool_t loopEnabled;
     uint32_t loopCount;
     HcaDecodeFunc decodeFunc;
+    // Maximum size of decoded blocks kept for re-reading, in bytes. 0 means unlimited.
+    uint32_t blockCacheSize;
+    // Sample format of the wave data. The default follows decodeFunc (16-bit PCM for custom functions).
+    // If decodeFunc is null, the matching built-in function is used.
+    CGSS_HCA_WAVE_FORMAT waveFormat;
 
 } HCA_DECODER_CONFIG;
 
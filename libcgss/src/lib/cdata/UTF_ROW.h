@@ -3,7 +3,7 @@
 #include "../cgss_env.h"
 #include "UTF_FIELD.h"
 
-// Used for viewing only. Alternative is CUtfTable::UtfRow.
+// Used for viewing only. Alternative is reading fields from CUtfTable directly.
 typedef struct _UTF_ROW {
 
     uint32_t baseOffset;
@@ -9,3 +9,4 @@
 #include "cdata/UTF_TABLE.h"
 #include "cdata/AFS2_FILE_RECORD.h"
 #include "cdata/ACB_CUE_RECORD.h"
+#include "cdata/ACB_CATALOG_ENTRY.h"
@@ -14,6 +14,24 @@ typedef enum _CGSS_HCA_CIPHER_TYPE {
     CGSS_HCA_CIPH_FORCE_DWORD = 0x7fffffff
 } CGSS_HCA_CIPHER_TYPE;
 
+typedef enum _CGSS_HCA_WAVE_FORMAT {
+    CGSS_HCA_WAVE_FORMAT_DEFAULT = 0,
+    CGSS_HCA_WAVE_FORMAT_PCM_U8 = 1,
+    CGSS_HCA_WAVE_FORMAT_PCM_S16 = 2,
+    CGSS_HCA_WAVE_FORMAT_PCM_S24 = 3,
+    CGSS_HCA_WAVE_FORMAT_PCM_S32 = 4,
+    CGSS_HCA_WAVE_FORMAT_FLOAT = 5,
+    CGSS_HCA_WAVE_FORMAT_FORCE_DWORD = 0x7fffffff
+} CGSS_HCA_WAVE_FORMAT;
+
+typedef enum _CGSS_CRI_FORMAT {
+    CGSS_CRI_FORMAT_UNKNOWN = 0,
+    CGSS_CRI_FORMAT_HCA = 1,
+    CGSS_CRI_FORMAT_UTF = 2,
+    CGSS_CRI_FORMAT_AFS2 = 3,
+    CGSS_CRI_FORMAT_FORCE_DWORD = 0x7fffffff
+} CGSS_CRI_FORMAT;
+
 typedef enum _CGSS_UTF_COLUMN_TYPE {
     CGSS_UTF_COLUMN_TYPE_U8 = 0,
     CGSS_UTF_COLUMN_TYPE_S8 = 1,
@@ -18,6 +18,22 @@ CGSS_NS_BEGIN
         WithKey = CGSS_HCA_CIPH_WITH_KEY
     };
 
+    enum class HcaWaveFormat : uint32_t {
+        Default = CGSS_HCA_WAVE_FORMAT_DEFAULT,
+        PcmU8 = CGSS_HCA_WAVE_FORMAT_PCM_U8,
+        PcmS16 = CGSS_HCA_WAVE_FORMAT_PCM_S16,
+        PcmS24 = CGSS_HCA_WAVE_FORMAT_PCM_S24,
+        PcmS32 = CGSS_HCA_WAVE_FORMAT_PCM_S32,
+        Float = CGSS_HCA_WAVE_FORMAT_FLOAT
+    };
+
+    enum class CriFormat : uint32_t {
+        Unknown = CGSS_CRI_FORMAT_UNKNOWN,
+        Hca = CGSS_CRI_FORMAT_HCA,
+        Utf = CGSS_CRI_FORMAT_UTF,
+        Afs2 = CGSS_CRI_FORMAT_AFS2
+    };
+
     enum class UtfColumnType : uint8_t {
         U8 = CGSS_UTF_COLUMN_TYPE_U8,
         S8 = CGSS_UTF_COLUMN_TYPE_S8,
@@ -12,13 +12,17 @@
 #include "takamori/streams/IStream.h"
 #include "takamori/streams/CStream.h"
 #include "takamori/streams/CMemoryStream.h"
+#include "takamori/streams/CMappedFileStream.h"
 #include "takamori/streams/CFileStream.h"
+#include "takamori/streams/CReadAheadStream.h"
+#include "takamori/streams/CSubStream.h"
 #include "takamori/streams/CBinaryReader.h"
 #include "takamori/streams/CBinaryWriter.h"
 
 #include "takamori/CBitConverter.h"
 #include "takamori/CPath.h"
 #include "takamori/CFileSystem.h"
+#include "takamori/CParallel.h"
 
 #include "kawashima/hca/CHcaFormatReader.h"
 #include "kawashima/hca/CDefaultWaveGenerator.h"
@@ -31,3 +35,5 @@
 #include "ichinose/CUtfTable.h"
 #include "ichinose/CAfs2Archive.h"
 #include "ichinose/CAcbFile.h"
+#include "ichinose/CCriFormatProbe.h"
+#include "ichinose/CAcbCatalog.h"
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "../cgss_env.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define __CGSS_SIMD_X86__
+#endif
+
+#ifdef __CGSS_SIMD_X86__
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#include <immintrin.h>
+
+// Functions using intrinsics above the compiler's baseline must be marked for GCC/Clang.
+// MSVC accepts the intrinsics anywhere.
+#if defined(__GNUC__) || defined(__clang__)
+#define CGSS_TARGET_SSE2 __attribute__((target("sse2")))
+#define CGSS_TARGET_AVX __attribute__((target("avx")))
+#define CGSS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CGSS_TARGET_SSE2
+#define CGSS_TARGET_AVX
+#define CGSS_TARGET_AVX2
+#endif
+
+#endif
+
+CGSS_NS_BEGIN
+
+    struct CpuFeatures {
+        bool_t sse2;
+        bool_t avx;
+        bool_t avx2;
+    };
+
+#ifdef __CGSS_SIMD_X86__
+
+    inline void cpuid(uint32_t leaf, uint32_t subLeaf, uint32_t regs[4]) {
+#ifdef _MSC_VER
+        int r[4];
+        __cpuidex(r, static_cast<int>(leaf), static_cast<int>(subLeaf));
+        for (auto i = 0; i < 4; ++i) {
+            regs[i] = static_cast<uint32_t>(r[i]);
+        }
+#else
+        __cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    }
+
+    inline uint64_t xgetbv0() {
+#ifdef _MSC_VER
+        return _xgetbv(0);
+#else
+        uint32_t eax, edx;
+        __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+    }
+
+    inline CpuFeatures DetectCpuFeatures() {
+        CpuFeatures features = {FALSE, FALSE, FALSE};
+        uint32_t regs[4];
+
+        cpuid(0, 0, regs);
+        const auto maxLeaf = regs[0];
+        if (maxLeaf < 1) {
+            return features;
+        }
+
+        cpuid(1, 0, regs);
+        features.sse2 = static_cast<bool_t>((regs[3] >> 26) & 1);
+        const auto osxsave = ((regs[2] >> 27) & 1) != 0;
+        const auto avx = ((regs[2] >> 28) & 1) != 0;
+        // The OS must save the YMM registers on context switches (XCR0 bits 1 and 2).
+        if (osxsave && avx && (xgetbv0() & 0x6) == 0x6) {
+            features.avx = TRUE;
+            if (maxLeaf >= 7) {
+                cpuid(7, 0, regs);
+                features.avx2 = static_cast<bool_t>((regs[1] >> 5) & 1);
+            }
+        }
+        return features;
+    }
+
+#else
+
+    inline CpuFeatures DetectCpuFeatures() {
+        CpuFeatures features = {FALSE, FALSE, FALSE};
+        return features;
+    }
+
+#endif
+
+    /**
+     * Gets the SIMD features of the running CPU. Detection runs once per process.
+     */
+    inline const CpuFeatures &GetCpuFeatures() {
+        static const CpuFeatures features = DetectCpuFeatures();
+        return features;
+    }
+
+CGSS_NS_END
@@ -0,0 +1,456 @@
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include "../takamori/streams/CFileStream.h"
+#include "../takamori/streams/CMappedFileStream.h"
+#include "../takamori/exceptions/CFormatException.h"
+#include "../takamori/CFileSystem.h"
+#include "../takamori/CParallel.h"
+#include "../takamori/CPath.h"
+#include "CAcbFile.h"
+#include "CAfs2Archive.h"
+#include "CAcbCatalog.h"
+
+#ifdef _MSC_VER
+#undef max
+#undef min
+#endif
+
+using namespace std;
+using namespace cgss;
+
+static const char CatalogSignature[8] = {'C', 'G', 'S', 'S', 'C', 'A', 'T', 'L'};
+static const uint32_t CatalogVersion = 1;
+static const uint32_t SamplesPerBlock = 0x80 * 8;
+
+struct CatalogHeader {
+    char signature[8];
+    uint32_t version;
+    uint32_t entrySize;
+    uint32_t entryCount;
+    uint32_t stringsSize;
+    uint64_t entriesOffset;
+    uint64_t cueNameIndexOffset;
+    uint64_t cueIdIndexOffset;
+    uint64_t waveformIdIndexOffset;
+    uint64_t stringsOffset;
+};
+
+// The entries of one scanned file. Strings are kept aside until the string pool is built.
+struct ScannedFile {
+    vector<ACB_CATALOG_ENTRY> entries;
+    vector<string> cueNames;
+    string externalAwbPath;
+    bool_t isSkipped;
+};
+
+static void ScanAcbFile(const string &path, ScannedFile &result);
+
+static void ScanAwbFile(const string &path, ScannedFile &result);
+
+static void SetHcaInfo(ACB_CATALOG_ENTRY &entry, const HCA_INFO &hcaInfo);
+
+static bool_t HasExtension(const string &path, const char *extension);
+
+static bool_t IsInRange(uint64_t offset, uint64_t size, uint64_t length);
+
+CAcbCatalog::CAcbCatalog(const char *fileName) {
+    _stream = new CMappedFileStream(fileName);
+
+    const auto length = _stream->GetLength();
+    const auto data = _stream->GetBuffer();
+    CatalogHeader header = {0};
+
+    if (length >= sizeof(header)) {
+        memcpy(&header, data, sizeof(header));
+    }
+
+    const uint64_t indexSize = static_cast<uint64_t>(header.entryCount) * sizeof(uint32_t);
+
+    if (length < sizeof(header) || memcmp(header.signature, CatalogSignature, sizeof(CatalogSignature)) != 0 ||
+        header.version != CatalogVersion || header.entrySize != sizeof(ACB_CATALOG_ENTRY) ||
+        header.entriesOffset % alignof(ACB_CATALOG_ENTRY) != 0 ||
+        !IsInRange(header.entriesOffset, static_cast<uint64_t>(header.entryCount) * sizeof(ACB_CATALOG_ENTRY), length) ||
+        header.cueNameIndexOffset % sizeof(uint32_t) != 0 || !IsInRange(header.cueNameIndexOffset, indexSize, length) ||
+        header.cueIdIndexOffset % sizeof(uint32_t) != 0 || !IsInRange(header.cueIdIndexOffset, indexSize, length) ||
+        header.waveformIdIndexOffset % sizeof(uint32_t) != 0 || !IsInRange(header.waveformIdIndexOffset, indexSize, length) ||
+        header.stringsSize == 0 || !IsInRange(header.stringsOffset, header.stringsSize, length) ||
+        data[header.stringsOffset + header.stringsSize - 1] != '\0') {
+        delete _stream;
+        throw CFormatException("Invalid ACB catalog.");
+    }
+
+    _entries = reinterpret_cast<const ACB_CATALOG_ENTRY *>(data + header.entriesOffset);
+    _entryCount = header.entryCount;
+    _cueNameIndex = reinterpret_cast<const uint32_t *>(data + header.cueNameIndexOffset);
+    _cueIdIndex = reinterpret_cast<const uint32_t *>(data + header.cueIdIndexOffset);
+    _waveformIdIndex = reinterpret_cast<const uint32_t *>(data + header.waveformIdIndexOffset);
+    _strings = reinterpret_cast<const char *>(data + header.stringsOffset);
+    _stringsSize = header.stringsSize;
+}
+
+CAcbCatalog::~CAcbCatalog() {
+    delete _stream;
+    _stream = nullptr;
+}
+
+uint32_t CAcbCatalog::GetEntryCount() const {
+    return _entryCount;
+}
+
+const ACB_CATALOG_ENTRY *CAcbCatalog::GetEntry(uint32_t index) const {
+    return index < _entryCount ? &_entries[index] : nullptr;
+}
+
+const char *CAcbCatalog::GetCueName(const ACB_CATALOG_ENTRY &entry) const {
+    return GetString(entry.cueNameOffset);
+}
+
+const char *CAcbCatalog::GetContainerPath(const ACB_CATALOG_ENTRY &entry) const {
+    return GetString(entry.containerPathOffset);
+}
+
+vector<const ACB_CATALOG_ENTRY *> CAcbCatalog::FindByCueName(const char *cueName) const {
+    return FindInIndex(_cueNameIndex, [this, cueName](const ACB_CATALOG_ENTRY &entry) {
+        return strcmp(GetCueName(entry), cueName);
+    });
+}
+
+vector<const ACB_CATALOG_ENTRY *> CAcbCatalog::FindByCueId(uint32_t cueId) const {
+    return FindInIndex(_cueIdIndex, [cueId](const ACB_CATALOG_ENTRY &entry) {
+        return entry.cueId < cueId ? -1 : (entry.cueId > cueId ? 1 : 0);
+    });
+}
+
+vector<const ACB_CATALOG_ENTRY *> CAcbCatalog::FindByWaveformId(uint32_t waveformId) const {
+    return FindInIndex(_waveformIdIndex, [waveformId](const ACB_CATALOG_ENTRY &entry) {
+        return entry.waveformId < waveformId ? -1 : (entry.waveformId > waveformId ? 1 : 0);
+    });
+}
+
+const char *CAcbCatalog::GetString(uint32_t offset) const {
+    if (offset >= _stringsSize) {
+        throw CFormatException("Invalid ACB catalog.");
+    }
+
+    // The string pool ends with a null character, so every string in it is terminated.
+    return _strings + offset;
+}
+
+template<typename TCompare>
+vector<const ACB_CATALOG_ENTRY *> CAcbCatalog::FindInIndex(const uint32_t *index, const TCompare &compare) const {
+    const auto getEntry = [this, index](uint32_t position) {
+        const auto entry = GetEntry(index[position]);
+
+        if (entry == nullptr) {
+            throw CFormatException("Invalid ACB catalog.");
+        }
+
+        return entry;
+    };
+
+    uint32_t low = 0, high = _entryCount;
+
+    while (low < high) {
+        const auto middle = low + (high - low) / 2;
+
+        if (compare(*getEntry(middle)) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    vector<const ACB_CATALOG_ENTRY *> result;
+
+    for (auto i = low; i < _entryCount; ++i) {
+        const auto entry = getEntry(i);
+
+        if (compare(*entry) != 0) {
+            break;
+        }
+
+        result.push_back(entry);
+    }
+
+    return result;
+}
+
+uint32_t CAcbCatalog::Build(const char *directory, const char *catalogFileName, uint32_t threadCount, vector<string> *skippedFiles) {
+    vector<string> files;
+
+    if (!CFileSystem::GetFilesRecursive(directory, files)) {
+        throw CException(string("Cannot open directory ") + directory + ".");
+    }
+
+    sort(files.begin(), files.end());
+
+    vector<string> acbPaths, awbPaths;
+
+    for (auto &path : files) {
+        if (HasExtension(path, ".acb")) {
+            acbPaths.push_back(path);
+        } else if (HasExtension(path, ".awb")) {
+            awbPaths.push_back(path);
+        }
+    }
+
+    vector<ScannedFile> scannedAcbFiles(acbPaths.size());
+
+    CParallel::For(static_cast<uint32_t>(acbPaths.size()), threadCount, [&](uint32_t i) {
+        ScanAcbFile(acbPaths[i], scannedAcbFiles[i]);
+    });
+
+    // AWB files found through an ACB are in the catalog already.
+    unordered_set<string> externalAwbPaths;
+
+    for (auto &scannedFile : scannedAcbFiles) {
+        if (!scannedFile.externalAwbPath.empty()) {
+            externalAwbPaths.insert(scannedFile.externalAwbPath);
+        }
+    }
+
+    awbPaths.erase(remove_if(awbPaths.begin(), awbPaths.end(), [&](const string &path) {
+        return externalAwbPaths.find(path) != externalAwbPaths.end();
+    }), awbPaths.end());
+
+    vector<ScannedFile> scannedAwbFiles(awbPaths.size());
+
+    CParallel::For(static_cast<uint32_t>(awbPaths.size()), threadCount, [&](uint32_t i) {
+        ScanAwbFile(awbPaths[i], scannedAwbFiles[i]);
+    });
+
+    // Strings are pooled without duplicates. Offset 0 is the empty string.
+    string strings(1, '\0');
+    unordered_map<string, uint32_t> stringOffsets;
+
+    const auto addString = [&](const string &str) -> uint32_t {
+        if (str.empty()) {
+            return 0;
+        }
+
+        const auto found = stringOffsets.find(str);
+
+        if (found != stringOffsets.end()) {
+            return found->second;
+        }
+
+        const auto offset = static_cast<uint32_t>(strings.size());
+
+        strings.append(str.c_str(), str.size() + 1);
+        stringOffsets.emplace(str, offset);
+
+        return offset;
+    };
+
+    vector<ACB_CATALOG_ENTRY> entries;
+
+    const auto addEntries = [&](const vector<string> &paths, vector<ScannedFile> &scannedFiles) {
+        for (size_t i = 0; i < paths.size(); ++i) {
+            auto &scannedFile = scannedFiles[i];
+
+            if (scannedFile.isSkipped) {
+                if (skippedFiles) {
+                    skippedFiles->push_back(paths[i]);
+                }
+
+                continue;
+            }
+
+            const auto pathOffset = addString(paths[i]);
+            const auto externalAwbPathOffset = addString(scannedFile.externalAwbPath);
+
+            for (size_t j = 0; j < scannedFile.entries.size(); ++j) {
+                auto entry = scannedFile.entries[j];
+
+                entry.cueNameOffset = addString(scannedFile.cueNames[j]);
+                entry.containerPathOffset = entry.isStreaming && !scannedFile.externalAwbPath.empty() ? externalAwbPathOffset : pathOffset;
+
+                entries.push_back(entry);
+            }
+
+            scannedFile = ScannedFile();
+        }
+    };
+
+    addEntries(acbPaths, scannedAcbFiles);
+    addEntries(awbPaths, scannedAwbFiles);
+
+    const auto entryCount = static_cast<uint32_t>(entries.size());
+    vector<uint32_t> cueNameIndex(entryCount), cueIdIndex(entryCount), waveformIdIndex(entryCount);
+
+    for (uint32_t i = 0; i < entryCount; ++i) {
+        cueNameIndex[i] = cueIdIndex[i] = waveformIdIndex[i] = i;
+    }
+
+    // Stable, so that entries with the same key stay in catalog order.
+    stable_sort(cueNameIndex.begin(), cueNameIndex.end(), [&](uint32_t left, uint32_t right) {
+        return strcmp(strings.c_str() + entries[left].cueNameOffset, strings.c_str() + entries[right].cueNameOffset) < 0;
+    });
+    stable_sort(cueIdIndex.begin(), cueIdIndex.end(), [&](uint32_t left, uint32_t right) {
+        return entries[left].cueId < entries[right].cueId;
+    });
+    stable_sort(waveformIdIndex.begin(), waveformIdIndex.end(), [&](uint32_t left, uint32_t right) {
+        return entries[left].waveformId < entries[right].waveformId;
+    });
+
+    const uint64_t indexSize = static_cast<uint64_t>(entryCount) * sizeof(uint32_t);
+    CatalogHeader header = {0};
+
+    memcpy(header.signature, CatalogSignature, sizeof(CatalogSignature));
+    header.version = CatalogVersion;
+    header.entrySize = sizeof(ACB_CATALOG_ENTRY);
+    header.entryCount = entryCount;
+    header.stringsSize = static_cast<uint32_t>(strings.size());
+    header.entriesOffset = sizeof(CatalogHeader);
+    header.cueNameIndexOffset = header.entriesOffset + static_cast<uint64_t>(entryCount) * sizeof(ACB_CATALOG_ENTRY);
+    header.cueIdIndexOffset = header.cueNameIndexOffset + indexSize;
+    header.waveformIdIndexOffset = header.cueIdIndexOffset + indexSize;
+    header.stringsOffset = header.waveformIdIndexOffset + indexSize;
+
+    CFileStream fs(catalogFileName, FileMode::Create, FileAccess::Write);
+
+    const auto write = [&fs](const void *data, uint64_t size) {
+        auto bytes = static_cast<const uint8_t *>(data);
+
+        while (size > 0) {
+            const auto count = static_cast<uint32_t>(std::min<uint64_t>(size, 0x40000000));
+
+            fs.Write(bytes, count, 0, count);
+            bytes += count;
+            size -= count;
+        }
+    };
+
+    write(&header, sizeof(header));
+    write(entries.data(), static_cast<uint64_t>(entryCount) * sizeof(ACB_CATALOG_ENTRY));
+    write(cueNameIndex.data(), indexSize);
+    write(cueIdIndex.data(), indexSize);
+    write(waveformIdIndex.data(), indexSize);
+    write(strings.data(), strings.size());
+
+    return entryCount;
+}
+
+static void ScanAcbFile(const string &path, ScannedFile &result) {
+    result.isSkipped = FALSE;
+
+    CAfs2Archive *internalAwb = nullptr, *externalAwb = nullptr;
+
+    try {
+        CMappedFileStream stream(path.c_str());
+        CAcbFile acb(&stream, path.c_str());
+
+        acb.Initialize();
+
+        internalAwb = acb.GetInternalAwb();
+        externalAwb = acb.GetExternalAwb();
+
+        // Files are scanned in parallel already.
+        const auto internalHcaInfos = internalAwb ? internalAwb->ReadHcaInfos(1) : map<uint32_t, HCA_INFO>();
+        const auto externalHcaInfos = externalAwb ? externalAwb->ReadHcaInfos(1) : map<uint32_t, HCA_INFO>();
+
+        if (externalAwb) {
+            result.externalAwbPath = externalAwb->GetFileName();
+        }
+
+        for (auto &cue : acb.GetCues()) {
+            const auto archive = cue.isStreaming ? externalAwb : internalAwb;
+
+            if (!cue.isWaveformIdentified || archive == nullptr) {
+                continue;
+            }
+
+            const auto &files = archive->GetFiles();
+            const auto file = files.find(cue.waveformId);
+
+            if (file == files.end()) {
+                continue;
+            }
+
+            ACB_CATALOG_ENTRY entry = {0};
+
+            entry.offset = file->second.fileOffsetAligned;
+            entry.size = file->second.fileSize;
+            entry.cueId = cue.cueId;
+            entry.waveformId = cue.waveformId;
+            entry.encodeType = cue.encodeType;
+            entry.isStreaming = static_cast<uint8_t>(cue.isStreaming ? 1 : 0);
+
+            const auto &hcaInfos = cue.isStreaming ? externalHcaInfos : internalHcaInfos;
+            const auto hcaInfo = hcaInfos.find(cue.waveformId);
+
+            if (hcaInfo != hcaInfos.end()) {
+                SetHcaInfo(entry, hcaInfo->second);
+            }
+
+            result.entries.push_back(entry);
+            result.cueNames.push_back(cue.cueName);
+        }
+    } catch (const CException &) {
+        result = ScannedFile();
+        result.isSkipped = TRUE;
+    }
+
+    delete internalAwb;
+    delete externalAwb;
+}
+
+static void ScanAwbFile(const string &path, ScannedFile &result) {
+    result.isSkipped = FALSE;
+
+    try {
+        CMappedFileStream stream(path.c_str());
+        CAfs2Archive archive(&stream, 0, path.c_str(), FALSE);
+        const auto hcaInfos = archive.ReadHcaInfos(1);
+
+        for (auto &file : archive.GetFiles()) {
+            ACB_CATALOG_ENTRY entry = {0};
+
+            entry.offset = file.second.fileOffsetAligned;
+            entry.size = file.second.fileSize;
+            entry.cueId = entry.waveformId = file.second.cueId;
+            entry.encodeType = ACB_CATALOG_UNKNOWN_ENCODE_TYPE;
+            entry.isStreaming = 1;
+
+            const auto hcaInfo = hcaInfos.find(file.first);
+
+            if (hcaInfo != hcaInfos.end()) {
+                entry.encodeType = CGSS_ACB_WAVEFORM_HCA;
+                SetHcaInfo(entry, hcaInfo->second);
+            }
+
+            result.entries.push_back(entry);
+            result.cueNames.emplace_back();
+        }
+    } catch (const CException &) {
+        result = ScannedFile();
+        result.isSkipped = TRUE;
+    }
+}
+
+static void SetHcaInfo(ACB_CATALOG_ENTRY &entry, const HCA_INFO &hcaInfo) {
+    entry.channelCount = hcaInfo.channelCount;
+    entry.samplingRate = hcaInfo.samplingRate;
+    entry.sampleCount = static_cast<uint64_t>(hcaInfo.blockCount) * SamplesPerBlock;
+    entry.loopExists = static_cast<uint8_t>(hcaInfo.loopExists ? 1 : 0);
+
+    if (hcaInfo.loopExists) {
+        // The same loop points CHcaDecoder writes to the "smpl" chunk.
+        entry.loopStart = hcaInfo.loopStart * SamplesPerBlock + hcaInfo.fmtR02;
+        entry.loopEnd = hcaInfo.loopEnd * SamplesPerBlock;
+    }
+}
+
+static bool_t HasExtension(const string &path, const char *extension) {
+    auto pathExtension = CPath::GetExtension(path);
+
+    // Extensions are ASCII, so tolower() is fine here.
+    transform(pathExtension.begin(), pathExtension.end(), pathExtension.begin(), ::tolower);
+
+    return static_cast<bool_t>(pathExtension == extension);
+}
+
+static bool_t IsInRange(uint64_t offset, uint64_t size, uint64_t length) {
+    return static_cast<bool_t>(offset <= length && size <= length - offset);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "../cgss_env.h"
+#include "../cdata/ACB_CATALOG_ENTRY.h"
+
+CGSS_NS_BEGIN
+
+    class CMappedFileStream;
+
+    /**
+     * A catalog of the waveforms in a directory tree of ACB and AWB files, for finding which file holds a cue.
+     * @remarks The catalog file is mapped into memory and used as it is: opening it only checks its header, and lookups
+     * are binary searches in sorted indices. Catalog files are in the byte order of the machine that built them.
+     */
+    class CGSS_EXPORT CAcbCatalog final {
+
+    __root_class(CAcbCatalog);
+
+    public:
+
+        /**
+         * Opens a catalog file.
+         * @throws CFormatException The file is not a catalog, or was built by another version.
+         */
+        explicit CAcbCatalog(const char *fileName);
+
+        CAcbCatalog(const CAcbCatalog &) = delete;
+
+        ~CAcbCatalog();
+
+        uint32_t GetEntryCount() const;
+
+        /**
+         * Gets an entry by its index.
+         * @remarks The entries of ACB files come first, then those of standalone AWB files, both in path order. The entries
+         * of a file are in cue order (or file order in a standalone AWB).
+         * @return The entry, or nullptr if the index is out of range.
+         */
+        const ACB_CATALOG_ENTRY *GetEntry(uint32_t index) const;
+
+        /**
+         * Gets the cue name of an entry, with the extension for its encode type. It is empty for a standalone AWB.
+         */
+        const char *GetCueName(const ACB_CATALOG_ENTRY &entry) const;
+
+        /**
+         * Gets the path of the file the waveform is in, as found under the scanned directory.
+         */
+        const char *GetContainerPath(const ACB_CATALOG_ENTRY &entry) const;
+
+        /**
+         * Finds the entries with a cue name, in logarithmic time.
+         * @return The entries, in catalog order.
+         */
+        std::vector<const ACB_CATALOG_ENTRY *> FindByCueName(const char *cueName) const;
+
+        /**
+         * @see FindByCueName
+         */
+        std::vector<const ACB_CATALOG_ENTRY *> FindByCueId(uint32_t cueId) const;
+
+        /**
+         * @see FindByCueName
+         */
+        std::vector<const ACB_CATALOG_ENTRY *> FindByWaveformId(uint32_t waveformId) const;
+
+        /**
+         * Scans a directory tree for ACB files and the AWB files that belong to no ACB, and writes a catalog of their waveforms.
+         * @remarks The files are read on up to threadCount threads. Files that cannot be read are skipped.
+         * HCA information is read from the HCA headers; it is left at 0 for other codecs.
+         * @param threadCount 0 means CParallel::GetDefaultThreadCount().
+         * @param skippedFiles Receives the paths of the files that were skipped. Can be nullptr.
+         * @return Number of entries in the catalog.
+         */
+        static uint32_t Build(const char *directory, const char *catalogFileName, uint32_t threadCount, std::vector<std::string> *skippedFiles);
+
+    private:
+
+        const char *GetString(uint32_t offset) const;
+
+        /**
+         * Finds the entries that compare equal to a key in a sorted index.
+         * @param compare Returns a negative number if an entry sorts before the key, 0 if it matches and a positive number otherwise.
+         */
+        template<typename TCompare>
+        std::vector<const ACB_CATALOG_ENTRY *> FindInIndex(const uint32_t *index, const TCompare &compare) const;
+
+        CMappedFileStream *_stream;
+        const ACB_CATALOG_ENTRY *_entries;
+        uint32_t _entryCount;
+        // Entry indices sorted by cue name, cue ID and waveform ID.
+        const uint32_t *_cueNameIndex;
+        const uint32_t *_cueIdIndex;
+        const uint32_t *_waveformIdIndex;
+        const char *_strings;
+        uint32_t _stringsSize;
+
+    };
+
+CGSS_NS_END
@@ -5,23 +5,41 @@
 #include "../takamori/exceptions/CInvalidOperationException.h"
 #include "../takamori/exceptions/CFormatException.h"
 #include "../takamori/streams/CBinaryReader.h"
+#include "../takamori/streams/CBinaryWriter.h"
 #include "../takamori/streams/CFileStream.h"
+#include "../takamori/streams/CMappedFileStream.h"
 #include "../takamori/CFileSystem.h"
 #include "../takamori/streams/CMemoryStream.h"
+#include "../takamori/streams/CSubStream.h"
 #include "../takamori/CPath.h"
 #include "CAcbHelper.h"
 #include "CAcbFile.h"
-#include "CUtfField.h"
 
 using namespace cgss;
 using namespace std;
 
 static string GetExtensionForEncodeType(uint8_t encodeType);
 
+template<typename T>
+bool_t GetFieldValueAsNumber(CUtfTable *table, uint32_t rowIndex, int32_t columnIndex, T *result);
+
 template<typename T>
 bool_t GetFieldValueAsNumber(CUtfTable *table, uint32_t rowIndex, const char *fieldName, T *result);
 
-bool_t GetFieldValueAsString(CUtfTable *table, uint32_t rowIndex, const char *fieldName, string &s);
+bool_t GetFieldValueAsString(CUtfTable *table, uint32_t rowIndex, int32_t columnIndex, string &s);
+
+// An index file starts with the signature, the index version and the size of HCA_INFO, which all have to match.
+static const uint8_t AcbIndexSignature[] = {'C', 'G', 'S', 'S', 'A', 'C', 'B', 'I'};
+static const uint32_t AcbIndexVersion = 1;
+// Size of the start of the ACB that is hashed to validate an index.
+static const uint32_t AcbIndexHashedSize = 0x1000;
+static const uint32_t AcbIndexInitialCapacity = 0x10000;
+
+static uint64_t HashStreamStart(IStream *stream, uint64_t offset);
+
+static void WriteIndexString(CBinaryWriter &writer, const char *str, size_t length);
+
+static string ReadIndexString(CBinaryReader &reader);
 
 const uint32_t CAcbFile::KEY_MODIFIER_ENABLED_VERSION = 0x01300000;
 
@@ -33,6 +51,8 @@ CAcbFile::CAcbFile(IStream *stream, uint64_t streamOffset, const char *fileName)
     : MyBase(stream, streamOffset) {
     _internalAwb = nullptr;
     _externalAwb = nullptr;
+    _tableImage = nullptr;
+    _tableImageOffset = 0;
     _fileName = fileName;
 }
 
@@ -41,6 +61,9 @@ CAcbFile::~CAcbFile() {
         delete pair.second;
     }
 
+    delete _tableImage;
+    _tableImage = nullptr;
+
     delete _internalAwb;
     _internalAwb = nullptr;
     delete _externalAwb;
@@ -52,43 +75,106 @@ void CAcbFile::Initialize() {
 
     GetFieldValueAsNumber(this, 0, "Version", &_formatVersion);
 
+    InitializeTableImage();
     InitializeAcbTables();
     InitializeCueNameToWaveformTable();
+    InitializeCueIndices();
     InitializeAwbArchives();
 }
 
+bool_t CAcbFile::Initialize(const char *indexFileName) {
+    if (LoadIndex(indexFileName)) {
+        return TRUE;
+    }
+
+    Initialize();
+
+    try {
+        SaveIndex(indexFileName);
+    } catch (const CException &) {
+        // The ACB is usable without the index.
+    }
+
+    return FALSE;
+}
+
+void CAcbFile::InitializeTableImage() {
+    auto stream = GetStream();
+
+    if (CAcbHelper::GetMemoryBuffer(stream)) {
+        return;
+    }
+
+    const auto awbFileColumn = GetColumnIndex("AwbFile");
+    const auto columnCount = GetColumnCount();
+    uint64_t imageStart = 0, imageEnd = 0;
+
+    for (uint32_t i = 0; i < columnCount; ++i) {
+        uint64_t fieldOffset;
+        uint32_t fieldSize;
+
+        if (static_cast<int32_t>(i) == awbFileColumn || !GetFieldDataRange(0, i, &fieldOffset, &fieldSize) || fieldSize == 0) {
+            continue;
+        }
+
+        if (imageEnd == 0 || fieldOffset < imageStart) {
+            imageStart = fieldOffset;
+        }
+
+        if (fieldOffset + fieldSize > imageEnd) {
+            imageEnd = fieldOffset + fieldSize;
+        }
+    }
+
+    if (imageEnd == 0 || imageEnd > stream->GetLength()) {
+        return;
+    }
+
+    _tableImage = CAcbHelper::ExtractToNewStream(stream, imageStart, static_cast<uint32_t>(imageEnd - imageStart));
+    _tableImageOffset = imageStart;
+}
+
 void CAcbFile::InitializeAcbTables() {
     auto cueTable = GetTable("CueTable");
     auto waveformTable = GetTable("WaveformTable");
     auto synthTable = GetTable("SynthTable");
 
-    const auto cueCount = cueTable->GetRows().size();
+    const auto cueCount = cueTable->GetRowCount();
+
+    // Columns are resolved once here, not once per cue.
+    const auto cueIdColumn = cueTable->GetColumnIndex("CueId");
+    const auto referenceTypeColumn = cueTable->GetColumnIndex("ReferenceType");
+    const auto referenceIndexColumn = cueTable->GetColumnIndex("ReferenceIndex");
+    const auto referenceItemsColumn = synthTable->GetColumnIndex("ReferenceItems");
+    const auto streamingColumn = waveformTable->GetColumnIndex("Streaming");
+    const auto idColumn = waveformTable->GetColumnIndex("Id");
+    const auto streamAwbIdColumn = waveformTable->GetColumnIndex("StreamAwbId");
+    const auto memoryAwbIdColumn = waveformTable->GetColumnIndex("MemoryAwbId");
+    const auto encodeTypeColumn = waveformTable->GetColumnIndex("EncodeType");
 
     _cues.reserve(cueCount);
 
     uint64_t refItemOffset = 0;
     uint32_t refItemSize = 0, refCorrection = 0;
-    CBinaryReader reader(GetStream());
+    CBinaryReader reader(synthTable->GetStream());
 
     for (uint32_t i = 0; i < cueCount; ++i) {
         ACB_CUE_RECORD cue = {0};
 
         cue.isWaveformIdentified = FALSE;
-        GetFieldValueAsNumber(cueTable, i, "CueId", &cue.cueId);
-        GetFieldValueAsNumber(cueTable, i, "ReferenceType", &cue.referenceType);
-        GetFieldValueAsNumber(cueTable, i, "ReferenceIndex", &cue.referenceIndex);
+        GetFieldValueAsNumber(cueTable, i, cueIdColumn, &cue.cueId);
+        GetFieldValueAsNumber(cueTable, i, referenceTypeColumn, &cue.referenceType);
+        GetFieldValueAsNumber(cueTable, i, referenceIndexColumn, &cue.referenceIndex);
 
         switch (cue.referenceType) {
             case 2:
-                synthTable->GetFieldOffset(cue.referenceIndex, "ReferenceItems", &refItemOffset);
-                synthTable->GetFieldSize(cue.referenceIndex, "ReferenceItems", &refItemSize);
+                synthTable->GetFieldDataRange(cue.referenceIndex, static_cast<uint32_t>(referenceItemsColumn), &refItemOffset, &refItemSize);
                 refCorrection = refItemSize + 2;
                 break;
             case 3:
             case 8:
                 if (i == 0) {
-                    synthTable->GetFieldOffset(0, "ReferenceItems", &refItemOffset);
-                    synthTable->GetFieldSize(0, "ReferenceItems", &refItemSize);
+                    synthTable->GetFieldDataRange(0, static_cast<uint32_t>(referenceItemsColumn), &refItemOffset, &refItemSize);
                     refCorrection = refItemSize - 2;
                 } else {
                     refCorrection += 4;
@@ -102,29 +188,29 @@ void CAcbFile::InitializeAcbTables() {
             cue.waveformIndex = reader.PeekUInt16BE(refItemOffset + refCorrection);
 
             uint8_t isStreaming;
-            auto hasIsStreaming = GetFieldValueAsNumber(waveformTable, cue.waveformIndex, "Streaming", &isStreaming);
+            auto hasIsStreaming = GetFieldValueAsNumber(waveformTable, cue.waveformIndex, streamingColumn, &isStreaming);
 
             if (hasIsStreaming) {
                 cue.isStreaming = isStreaming;
 
                 uint16_t waveformId;
 
-                if (GetFieldValueAsNumber(waveformTable, cue.waveformIndex, "Id", &waveformId)) {
+                if (GetFieldValueAsNumber(waveformTable, cue.waveformIndex, idColumn, &waveformId)) {
                     cue.waveformId = waveformId;
                 } else {
                     if (cue.isStreaming) {
-                        if (GetFieldValueAsNumber(waveformTable, cue.waveformIndex, "StreamAwbId", &waveformId)) {
+                        if (GetFieldValueAsNumber(waveformTable, cue.waveformIndex, streamAwbIdColumn, &waveformId)) {
                             cue.waveformId = waveformId;
                         }
                     } else {
-                        if (GetFieldValueAsNumber(waveformTable, cue.waveformIndex, "MemoryAwbId", &waveformId)) {
+                        if (GetFieldValueAsNumber(waveformTable, cue.waveformIndex, memoryAwbIdColumn, &waveformId)) {
                             cue.waveformId = waveformId;
                         }
                     }
                 }
 
                 uint8_t encodeType;
-                if (GetFieldValueAsNumber(waveformTable, cue.waveformIndex, "EncodeType", &encodeType)) {
+                if (GetFieldValueAsNumber(waveformTable, cue.waveformIndex, encodeTypeColumn, &encodeType)) {
                     cue.encodeType = encodeType;
                 }
 
@@ -140,11 +226,14 @@ void CAcbFile::InitializeCueNameToWaveformTable() {
     auto cueNameTable = GetTable("CueNameTable");
     auto &cues = _cues;
 
-    auto cueNameCount = cueNameTable->GetRows().size();
+    const auto cueIndexColumn = cueNameTable->GetColumnIndex("CueIndex");
+    const auto cueNameColumn = cueNameTable->GetColumnIndex("CueName");
+
+    auto cueNameCount = cueNameTable->GetRowCount();
     for (uint32_t i = 0; i < cueNameCount; ++i) {
         uint16_t cueIndex;
 
-        if (!GetFieldValueAsNumber(cueNameTable, i, "CueIndex", &cueIndex)) {
+        if (!GetFieldValueAsNumber(cueNameTable, i, cueIndexColumn, &cueIndex)) {
             continue;
         }
 
@@ -153,7 +242,7 @@ void CAcbFile::InitializeCueNameToWaveformTable() {
         if (cue.isWaveformIdentified) {
             string cueName;
 
-            if (!GetFieldValueAsString(cueNameTable, i, "CueName", cueName)) {
+            if (!GetFieldValueAsString(cueNameTable, i, cueNameColumn, cueName)) {
                 continue;
             }
 
@@ -168,6 +257,250 @@ void CAcbFile::InitializeCueNameToWaveformTable() {
     }
 }
 
+void CAcbFile::InitializeCueIndices() {
+    const auto cueCount = static_cast<uint32_t>(_cues.size());
+
+    _cueIndicesByName.reserve(cueCount);
+    _cueIndicesById.reserve(cueCount);
+    _cueIndicesByWaveformId.reserve(cueCount);
+
+    for (uint32_t i = 0; i < cueCount; ++i) {
+        const auto &cue = _cues[i];
+
+        _cueIndicesByName.emplace(cue.cueName, i);
+        _cueIndicesById.emplace(cue.cueId, i);
+        _cueIndicesByWaveformId.emplace(cue.waveformId, i);
+    }
+}
+
+bool_t CAcbFile::LoadIndex(const char *indexFileName) {
+    uint64_t acbFileSize, indexFileSize;
+    int64_t acbLastWriteTime, indexLastWriteTime;
+
+    if (!CFileSystem::GetFileInfo(indexFileName, &indexFileSize, &indexLastWriteTime) ||
+        !CFileSystem::GetFileInfo(_fileName, &acbFileSize, &acbLastWriteTime)) {
+        return FALSE;
+    }
+
+    uint32_t formatVersion;
+    vector<ACB_CUE_RECORD> cues;
+    vector<string> fileNames;
+    CAfs2Archive *internalAwb = nullptr, *externalAwb = nullptr;
+
+    try {
+        CMappedFileStream indexStream(indexFileName);
+        CBinaryReader reader(&indexStream);
+        uint8_t signature[sizeof(AcbIndexSignature)];
+
+        if (reader.Read(signature, sizeof(signature), 0, sizeof(signature)) != sizeof(signature) ||
+            memcmp(signature, AcbIndexSignature, sizeof(signature)) != 0 ||
+            reader.ReadUInt32LE() != AcbIndexVersion ||
+            reader.ReadUInt32LE() != sizeof(HCA_INFO) ||
+            reader.ReadUInt64LE() != indexStream.GetLength()) {
+            return FALSE;
+        }
+
+        if (reader.ReadUInt64LE() != acbFileSize || reader.ReadInt64LE() != acbLastWriteTime ||
+            reader.ReadUInt64LE() != HashStreamStart(GetStream(), GetStreamOffset())) {
+            return FALSE;
+        }
+
+        const auto externalAwbFileName = ReadIndexString(reader);
+        const auto awbFileSize = reader.ReadUInt64LE();
+        const auto awbLastWriteTime = reader.ReadInt64LE();
+
+        if (externalAwbFileName != GetExpectedExternalAwbFileName()) {
+            return FALSE;
+        }
+
+        if (!externalAwbFileName.empty()) {
+            uint64_t fileSize;
+            int64_t lastWriteTime;
+
+            if (!CFileSystem::GetFileInfo(externalAwbFileName.c_str(), &fileSize, &lastWriteTime) ||
+                fileSize != awbFileSize || lastWriteTime != awbLastWriteTime) {
+                return FALSE;
+            }
+        }
+
+        formatVersion = reader.ReadUInt32LE();
+
+        const auto cueCount = reader.ReadUInt32LE();
+
+        if (cueCount > indexStream.GetLength()) {
+            throw CFormatException("Invalid ACB index.");
+        }
+
+        cues.reserve(cueCount);
+
+        for (uint32_t i = 0; i < cueCount; ++i) {
+            ACB_CUE_RECORD cue = {0};
+
+            cue.cueId = reader.ReadUInt32LE();
+            cue.referenceType = reader.ReadUInt8();
+            cue.referenceIndex = reader.ReadUInt16LE();
+            cue.isWaveformIdentified = reader.ReadUInt8();
+            cue.waveformIndex = reader.ReadUInt16LE();
+            cue.waveformId = reader.ReadUInt16LE();
+            cue.encodeType = reader.ReadUInt8();
+            cue.isStreaming = reader.ReadUInt8();
+
+            const auto cueName = ReadIndexString(reader);
+
+            if (cueName.size() >= ACB_CUE_RECORD_NAME_MAX_LEN) {
+                throw CFormatException("Invalid ACB index.");
+            }
+
+            memcpy(cue.cueName, cueName.c_str(), cueName.size());
+            cue.cueName[cueName.size()] = '\0';
+
+            cues.push_back(cue);
+        }
+
+        const auto fileNameCount = reader.ReadUInt32LE();
+
+        if (fileNameCount > indexStream.GetLength()) {
+            throw CFormatException("Invalid ACB index.");
+        }
+
+        fileNames.reserve(fileNameCount);
+
+        for (uint32_t i = 0; i < fileNameCount; ++i) {
+            fileNames.push_back(ReadIndexString(reader));
+        }
+
+        if (reader.ReadUInt8()) {
+            uint64_t internalAwbOffset;
+
+            if (!GetFieldOffset(0, "AwbFile", &internalAwbOffset)) {
+                throw CFormatException("Invalid ACB index.");
+            }
+
+            internalAwb = CAfs2Archive::ReadIndex(reader, GetStream(), internalAwbOffset, GetFileName(), FALSE);
+        }
+
+        if (reader.ReadUInt8()) {
+            if (externalAwbFileName.empty()) {
+                throw CFormatException("Invalid ACB index.");
+            }
+
+            const auto fs = new CFileStream(externalAwbFileName.c_str(), FileMode::OpenExisting, FileAccess::Read, TRUE);
+
+            try {
+                externalAwb = CAfs2Archive::ReadIndex(reader, fs, 0, externalAwbFileName.c_str(), TRUE);
+            } catch (...) {
+                delete fs;
+                throw;
+            }
+        }
+    } catch (const CException &) {
+        delete internalAwb;
+        delete externalAwb;
+        return FALSE;
+    }
+
+    _formatVersion = formatVersion;
+    _cues = std::move(cues);
+    _fileNames = std::move(fileNames);
+    _internalAwb = internalAwb;
+    _externalAwb = externalAwb;
+
+    for (auto &cue : _cues) {
+        if (cue.isWaveformIdentified && cue.cueName[0] != '\0') {
+            _cueNameToWaveform[cue.cueName] = cue.waveformId;
+        }
+    }
+
+    InitializeCueIndices();
+
+    return TRUE;
+}
+
+void CAcbFile::SaveIndex(const char *indexFileName) {
+    uint64_t acbFileSize, awbFileSize = 0;
+    int64_t acbLastWriteTime, awbLastWriteTime = 0;
+
+    // Without the file info the index could not be validated.
+    if (!CFileSystem::GetFileInfo(_fileName, &acbFileSize, &acbLastWriteTime)) {
+        return;
+    }
+
+    if (_externalAwb && !CFileSystem::GetFileInfo(_externalAwb->GetFileName(), &awbFileSize, &awbLastWriteTime)) {
+        return;
+    }
+
+    CMemoryStream memoryStream(AcbIndexInitialCapacity);
+    CBinaryWriter writer(&memoryStream);
+
+    writer.Write(AcbIndexSignature, sizeof(AcbIndexSignature), 0, sizeof(AcbIndexSignature));
+    writer.WriteUInt32LE(AcbIndexVersion);
+    writer.WriteUInt32LE(sizeof(HCA_INFO));
+
+    // Size of the index, filled in at the end so that a partly written file does not match.
+    const auto indexSizePosition = memoryStream.GetPosition();
+    writer.WriteUInt64LE(0);
+
+    writer.WriteUInt64LE(acbFileSize);
+    writer.WriteInt64LE(acbLastWriteTime);
+    writer.WriteUInt64LE(HashStreamStart(GetStream(), GetStreamOffset()));
+
+    const string externalAwbFileName = _externalAwb ? _externalAwb->GetFileName() : "";
+    WriteIndexString(writer, externalAwbFileName.c_str(), externalAwbFileName.size());
+    writer.WriteUInt64LE(awbFileSize);
+    writer.WriteInt64LE(awbLastWriteTime);
+
+    writer.WriteUInt32LE(_formatVersion);
+    writer.WriteUInt32LE(static_cast<uint32_t>(_cues.size()));
+
+    for (auto &cue : _cues) {
+        writer.WriteUInt32LE(cue.cueId);
+        writer.WriteUInt8(cue.referenceType);
+        writer.WriteUInt16LE(cue.referenceIndex);
+        writer.WriteUInt8(static_cast<uint8_t>(cue.isWaveformIdentified));
+        writer.WriteUInt16LE(cue.waveformIndex);
+        writer.WriteUInt16LE(cue.waveformId);
+        writer.WriteUInt8(cue.encodeType);
+        writer.WriteUInt8(static_cast<uint8_t>(cue.isStreaming));
+        WriteIndexString(writer, cue.cueName, strnlen(cue.cueName, ACB_CUE_RECORD_NAME_MAX_LEN));
+    }
+
+    writer.WriteUInt32LE(static_cast<uint32_t>(_fileNames.size()));
+
+    for (auto &fileName : _fileNames) {
+        WriteIndexString(writer, fileName.c_str(), fileName.size());
+    }
+
+    writer.WriteUInt8(_internalAwb ? 1 : 0);
+
+    if (_internalAwb) {
+        _internalAwb->WriteIndex(writer);
+    }
+
+    writer.WriteUInt8(_externalAwb ? 1 : 0);
+
+    if (_externalAwb) {
+        _externalAwb->WriteIndex(writer);
+    }
+
+    const auto indexSize = memoryStream.GetLength();
+
+    memoryStream.SetPosition(indexSizePosition);
+    writer.WriteUInt64LE(indexSize);
+
+    CFileStream indexStream(indexFileName, FileMode::Create, FileAccess::Write);
+    indexStream.Write(memoryStream.GetBuffer(), static_cast<uint32_t>(indexSize), 0, static_cast<uint32_t>(indexSize));
+}
+
+string CAcbFile::GetExpectedExternalAwbFileName() {
+    uint32_t externalAwbSize;
+
+    if (!GetFieldSize(0, "StreamAwbAfs2Header", &externalAwbSize) || externalAwbSize == 0) {
+        return string();
+    }
+
+    return FindExternalAwbFileName();
+}
+
 void CAcbFile::InitializeAwbArchives() {
     uint32_t internalAwbSize;
     if (GetFieldSize(0, "AwbFile", &internalAwbSize) && internalAwbSize > 0) {
@@ -211,6 +544,11 @@ CUtfTable *CAcbFile::ResolveTable(const char *tableName) {
         return nullptr;
     }
 
+    // Tables in the image are views of it.
+    if (_tableImage && tableOffset >= _tableImageOffset && tableOffset + tableSize <= _tableImageOffset + _tableImage->GetLength()) {
+        return new CUtfTable(_tableImage, tableOffset - _tableImageOffset);
+    }
+
     auto tbl = new CUtfTable(GetStream(), tableOffset);
 
     return tbl;
@@ -243,7 +581,8 @@ CAfs2Archive *CAcbFile::GetExternalAwb() {
 
     // Checksum checking is skipped.
 
-    const auto fs = new CFileStream(extAwbFileName.c_str(), FileMode::OpenExisting, FileAccess::Read);
+    // Positional, so that data streams of the archive can share the file (see GetDataStreamFromCueInfo()).
+    const auto fs = new CFileStream(extAwbFileName.c_str(), FileMode::OpenExisting, FileAccess::Read, TRUE);
     const auto archive = new CAfs2Archive(fs, 0, extAwbFileName.c_str(), TRUE);
 
     return archive;
@@ -253,17 +592,18 @@ const vector<string> &CAcbFile::GetFileNames() const {
     return _fileNames;
 }
 
+const vector<ACB_CUE_RECORD> &CAcbFile::GetCues() const {
+    return _cues;
+}
+
 IStream *CAcbFile::OpenDataStream(const char *fileName) {
-    IStream *result = nullptr;
+    const auto cue = FindCueByName(fileName);
 
-    for (auto &cue : _cues) {
-        if (strcmp(cue.cueName, fileName) == 0) {
-            result = GetDataStreamFromCueInfo(cue, fileName);
-            break;
-        }
+    if (cue == nullptr) {
+        return nullptr;
     }
 
-    return result;
+    return GetDataStreamFromCueInfo(*cue, fileName);
 }
 
 IStream *CAcbFile::OpenDataStream(uint32_t cueId) {
@@ -271,16 +611,31 @@ IStream *CAcbFile::OpenDataStream(uint32_t cueId) {
 
     sprintf(tempFileName, "cue #%u", cueId);
 
-    IStream *result = nullptr;
+    const auto cue = FindCueById(cueId);
 
-    for (auto &cue : _cues) {
-        if (cue.cueId == cueId) {
-            result = GetDataStreamFromCueInfo(cue, tempFileName);
-            break;
-        }
+    if (cue == nullptr) {
+        return nullptr;
     }
 
-    return result;
+    return GetDataStreamFromCueInfo(*cue, tempFileName);
+}
+
+const ACB_CUE_RECORD *CAcbFile::FindCueByName(const char *cueName) const {
+    const auto it = _cueIndicesByName.find(cueName);
+
+    return it != _cueIndicesByName.end() ? &_cues[it->second] : nullptr;
+}
+
+const ACB_CUE_RECORD *CAcbFile::FindCueById(uint32_t cueId) const {
+    const auto it = _cueIndicesById.find(cueId);
+
+    return it != _cueIndicesById.end() ? &_cues[it->second] : nullptr;
+}
+
+const ACB_CUE_RECORD *CAcbFile::FindCueByWaveformId(uint32_t waveformId) const {
+    const auto it = _cueIndicesByWaveformId.find(waveformId);
+
+    return it != _cueIndicesByWaveformId.end() ? &_cues[it->second] : nullptr;
 }
 
 IStream *CAcbFile::GetDataStreamFromCueInfo(const ACB_CUE_RECORD &cue, const char *fileNameForError) {
@@ -304,9 +659,22 @@ IStream *CAcbFile::GetDataStreamFromCueInfo(const ACB_CUE_RECORD &cue, const cha
 
         auto &file = files.at(cue.waveformId);
 
-        CFileStream fs(file.fileName, FileMode::OpenExisting, FileAccess::Read);
+        // Every data stream reads the shared file with a cursor of its own, so several cues can be decoded at once.
+        const auto archiveStream = dynamic_cast<CFileStream *>(externalAwb->GetStream());
+        CFileStream *fs;
+
+        if (archiveStream != nullptr && archiveStream->IsPositional()) {
+            fs = archiveStream->CreateReader();
+        } else {
+            fs = new CFileStream(file.fileName, FileMode::OpenExisting, FileAccess::Read);
+        }
 
-        result = CAcbHelper::ExtractToNewStream(&fs, file.fileOffsetAligned, static_cast<uint32_t>(file.fileSize));
+        try {
+            result = new CSubStream(fs, file.fileOffsetAligned, file.fileSize, TRUE);
+        } catch (...) {
+            delete fs;
+            throw;
+        }
     } else {
         auto internalAwb = _internalAwb;
 
@@ -322,7 +690,7 @@ IStream *CAcbFile::GetDataStreamFromCueInfo(const ACB_CUE_RECORD &cue, const cha
 
         auto &file = files.at(cue.waveformId);
 
-        result = CAcbHelper::ExtractToNewStream(GetStream(), file.fileOffsetAligned, static_cast<uint32_t>(file.fileSize));
+        result = new CSubStream(GetStream(), file.fileOffsetAligned, file.fileSize);
     }
 
     return result;
@@ -341,10 +709,10 @@ string CAcbFile::GetSymbolicFileNameFromCueId(uint32_t cueId) {
 }
 
 string CAcbFile::GetCueNameFromCueId(uint32_t cueId) {
-    for (auto &cue : _cues) {
-        if (cue.waveformId == cueId) {
-            return string(cue.cueName);
-        }
+    const auto cue = FindCueByWaveformId(cueId);
+
+    if (cue != nullptr) {
+        return string(cue->cueName);
     }
 
     return GetSymbolicFileNameFromCueId(cueId);
@@ -407,83 +775,81 @@ static string GetExtensionForEncodeType(uint8_t encodeType) {
     return string(buffer);
 }
 
-template<typename T>
-bool_t GetFieldValueAsNumber(CUtfTable *table, uint32_t rowIndex, const char *fieldName, T *result) {
-    if (result) {
-        memset(result, 0, sizeof(T));
+static uint64_t HashStreamStart(IStream *stream, uint64_t offset) {
+    uint8_t buffer[AcbIndexHashedSize];
+    const auto length = stream->GetLength();
+    uint32_t size = 0;
+
+    if (offset < length) {
+        size = length - offset < AcbIndexHashedSize ? static_cast<uint32_t>(length - offset) : AcbIndexHashedSize;
     }
 
-    auto &rows = table->GetRows();
+    const auto originalPosition = stream->GetPosition();
 
-    if (rowIndex >= rows.size()) {
-        return FALSE;
+    stream->Seek(offset, StreamSeekOrigin::Begin);
+    const auto read = CBinaryReader::PeekBytes(stream, buffer, sizeof(buffer), 0, size);
+    stream->Seek(originalPosition, StreamSeekOrigin::Begin);
+
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+
+    for (uint32_t i = 0; i < read; ++i) {
+        hash = (hash ^ buffer[i]) * 1099511628211ull;
     }
 
-    auto &row = rows[rowIndex];
-
-    for (auto &field : row.fields) {
-        if (strcmp(fieldName, field->name) == 0) {
-            if (result) {
-                switch (field->type) {
-                    case CGSS_UTF_COLUMN_TYPE_U8:
-                        *result = field->value.u8;
-                        break;
-                    case CGSS_UTF_COLUMN_TYPE_S8:
-                        *result = field->value.s8;
-                        break;
-                    case CGSS_UTF_COLUMN_TYPE_U16:
-                        *result = field->value.u16;
-                        break;
-                    case CGSS_UTF_COLUMN_TYPE_S16:
-                        *result = field->value.s16;
-                        break;
-                    case CGSS_UTF_COLUMN_TYPE_U32:
-                        *result = field->value.u32;
-                        break;
-                    case CGSS_UTF_COLUMN_TYPE_S32:
-                        *result = field->value.s32;
-                        break;
-                    case CGSS_UTF_COLUMN_TYPE_U64:
-                        *result = field->value.u64;
-                        break;
-                    case CGSS_UTF_COLUMN_TYPE_S64:
-                        *result = field->value.s64;
-                        break;
-                    case CGSS_UTF_COLUMN_TYPE_R32:
-                        *result = field->value.r32;
-                        break;
-                    case CGSS_UTF_COLUMN_TYPE_R64:
-                        *result = field->value.r64;
-                        break;
-                    default:
-                        throw CInvalidOperationException("Unsupported field type for retrieving numeric value.");
-                }
-            }
+    return hash;
+}
 
-            return TRUE;
-        }
+static void WriteIndexString(CBinaryWriter &writer, const char *str, size_t length) {
+    writer.WriteUInt32LE(static_cast<uint32_t>(length));
+    writer.Write(str, static_cast<uint32_t>(length), 0, static_cast<uint32_t>(length));
+}
+
+static string ReadIndexString(CBinaryReader &reader) {
+    const auto length = reader.ReadUInt32LE();
+
+    if (length > reader.GetLength() - reader.GetPosition()) {
+        throw CFormatException("Invalid ACB index.");
     }
 
-    return FALSE;
+    string str(length, '\0');
+
+    if (length > 0 && reader.Read(&str[0], length, 0, length) != length) {
+        throw CFormatException("Invalid ACB index.");
+    }
+
+    return str;
 }
 
-bool_t GetFieldValueAsString(CUtfTable *table, uint32_t rowIndex, const char *fieldName, string &s) {
-    auto &rows = table->GetRows();
+template<typename T>
+bool_t GetFieldValueAsNumber(CUtfTable *table, uint32_t rowIndex, int32_t columnIndex, T *result) {
+    T value;
+    const auto found = columnIndex >= 0 && table->GetFieldValue(rowIndex, static_cast<uint32_t>(columnIndex), &value);
 
-    if (rowIndex >= rows.size()) {
-        return FALSE;
+    if (result) {
+        *result = found ? value : 0;
     }
 
-    auto &row = rows[rowIndex];
+    return found;
+}
 
-    for (auto &field : row.fields) {
-        if (
-            strcmp(fieldName, field->name) == 0) {
-            s = string(field->value.str);
+template<typename T>
+bool_t GetFieldValueAsNumber(CUtfTable *table, uint32_t rowIndex, const char *fieldName, T *result) {
+    return GetFieldValueAsNumber(table, rowIndex, table->GetColumnIndex(fieldName), result);
+}
 
-            return TRUE;
-        }
+bool_t GetFieldValueAsString(CUtfTable *table, uint32_t rowIndex, int32_t columnIndex, string &s) {
+    if (columnIndex < 0) {
+        return FALSE;
     }
 
-    return FALSE;
+    const auto str = table->GetFieldString(rowIndex, static_cast<uint32_t>(columnIndex));
+
+    if (!str) {
+        return FALSE;
+    }
+
+    s = string(str);
+
+    return TRUE;
 }
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include "../cgss_env.h"
 #include "CUtfTable.h"
 #include "../cdata/ACB_CUE_RECORD.h"
@@ -12,6 +13,10 @@ CGSS_NS_BEGIN
 
     class CAfs2Archive;
 
+    class CMemoryStream;
+
+    class CBinaryReader;
+
     class CGSS_EXPORT CAcbFile final : public CUtfTable {
 
     __extends(CUtfTable, CAcbFile);
@@ -26,18 +31,66 @@ CGSS_NS_BEGIN
 
         const std::vector<std::string> &GetFileNames() const;
 
+        /**
+         * Gets the cues, in the order of the cue table.
+         */
+        const std::vector<ACB_CUE_RECORD> &GetCues() const;
+
         const char *GetFileName() const;
 
+        /**
+         * Opens the data of a cue as a stream, without copying it. The caller deletes the stream.
+         * @remarks Data in the internal AWB is read from the stream of this ACB, so the returned stream must not
+         * outlive it. Data in the external AWB is read from a file stream owned by the returned stream, which shares
+         * the open AWB file with positional reads; streams of different external cues can be read on different threads at once.
+         * @return The stream, or nullptr if the cue has no data.
+         */
         IStream *OpenDataStream(const char *fileName);
 
+        /**
+         * @see OpenDataStream(const char *)
+         */
         IStream *OpenDataStream(uint32_t cueId);
 
+        /**
+         * Finds a cue by its name (with the extension for its encode type), in constant time.
+         * @return The cue, or nullptr if there is no such cue. If names repeat, the first cue is found.
+         */
+        const ACB_CUE_RECORD *FindCueByName(const char *cueName) const;
+
+        /**
+         * Finds a cue by its ID, in constant time.
+         * @return The cue, or nullptr if there is no such cue.
+         */
+        const ACB_CUE_RECORD *FindCueById(uint32_t cueId) const;
+
+        /**
+         * Finds the first cue that plays a waveform, by the ID of the waveform in its AWB, in constant time.
+         * @return The cue, or nullptr if there is no such cue.
+         */
+        const ACB_CUE_RECORD *FindCueByWaveformId(uint32_t waveformId) const;
+
         static std::string GetSymbolicFileNameFromCueId(uint32_t cueId);
 
+        /**
+         * Gets the name of the cue playing a waveform, or the symbolic file name if no cue does.
+         * @param cueId ID of the waveform in its AWB, i.e. the cue ID of an AWB file record.
+         */
         std::string GetCueNameFromCueId(uint32_t cueId);
 
         void Initialize() override;
 
+        /**
+         * Initializes from an index file if it matches the ACB, otherwise initializes like Initialize() and writes the index file.
+         * @remarks The index holds the cues, the AWB file tables and the HCA information of the AWB files (see
+         * CAfs2Archive::ReadHcaInfos()), so loading it skips parsing the nested tables and the AWB headers. It matches if the
+         * size and modification time of the ACB file and the external AWB file, and a hash of the start of the ACB, are the
+         * ones recorded. The index is a cache: failing to write it is not an error.
+         * @param indexFileName Path of the index file, e.g. the ACB path with ".index" appended.
+         * @return TRUE if the index was loaded.
+         */
+        bool_t Initialize(const char *indexFileName);
+
         CAfs2Archive *GetInternalAwb();
 
         CAfs2Archive *GetExternalAwb();
@@ -48,12 +101,39 @@ CGSS_NS_BEGIN
 
     private:
 
+        /**
+         * Reads the part of the stream the nested tables are in with one read, so that the tables are parsed in memory.
+         * @remarks Nothing is read if the stream is in memory already. The internal AWB is left out.
+         */
+        void InitializeTableImage();
+
         void InitializeAcbTables();
 
         void InitializeCueNameToWaveformTable();
 
         void InitializeAwbArchives();
 
+        /**
+         * Indexes the cues by name, cue ID and waveform ID. The first cue wins if keys repeat.
+         */
+        void InitializeCueIndices();
+
+        /**
+         * Loads the state of an initialized ACB from an index file.
+         * @return FALSE if the index does not exist, does not match or is malformed. Nothing is changed then.
+         */
+        bool_t LoadIndex(const char *indexFileName);
+
+        /**
+         * Writes the state of the initialized ACB to an index file.
+         */
+        void SaveIndex(const char *indexFileName);
+
+        /**
+         * Gets the external AWB file name Initialize() would look for, or an empty string if there is no external AWB.
+         */
+        std::string GetExpectedExternalAwbFileName();
+
         IStream *GetDataStreamFromCueInfo(const ACB_CUE_RECORD &cue, const char *fileNameForError);
 
         std::string FindExternalAwbFileName();
@@ -72,7 +152,14 @@ CGSS_NS_BEGIN
         std::vector<std::string> _fileNames;
         std::vector<ACB_CUE_RECORD> _cues;
         std::map<std::string, CUtfTable *> _tables;
+        CMemoryStream *_tableImage;
+        // Offset of the table image in the stream.
+        uint64_t _tableImageOffset;
         std::map<std::string, uint16_t> _cueNameToWaveform;
+        // Indices in _cues.
+        std::unordered_map<std::string, uint32_t> _cueIndicesByName;
+        std::unordered_map<uint32_t, uint32_t> _cueIndicesById;
+        std::unordered_map<uint32_t, uint32_t> _cueIndicesByWaveformId;
 
         uint32_t _formatVersion;
 
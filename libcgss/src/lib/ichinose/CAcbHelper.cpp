@@ -1,5 +1,6 @@
 #include "CAcbHelper.h"
 #include "../takamori/streams/CMemoryStream.h"
+#include "../takamori/streams/CMappedFileStream.h"
 
 CGSS_NS_BEGIN
 
@@ -27,6 +28,18 @@ CGSS_NS_BEGIN
         return memory;
     }
 
+    const uint8_t *CAcbHelper::GetMemoryBuffer(IStream *stream) {
+        if (const auto memoryStream = dynamic_cast<CMemoryStream *>(stream)) {
+            return memoryStream->GetBuffer();
+        }
+
+        if (const auto mappedFileStream = dynamic_cast<CMappedFileStream *>(stream)) {
+            return mappedFileStream->GetBuffer();
+        }
+
+        return nullptr;
+    }
+
     uint64_t CAcbHelper::RoundUpToAlignment(uint64_t value, uint64_t alignment) {
         return (value + alignment - 1) / alignment * alignment;
     }
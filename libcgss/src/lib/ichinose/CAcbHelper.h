@@ -18,6 +18,12 @@ CGSS_NS_BEGIN
 
         static CMemoryStream *ExtractToNewStream(IStream *stream, uint64_t offset, uint32_t size);
 
+        /**
+         * Gets the content of a stream that is entirely in memory, i.e. a memory stream or a mapped file.
+         * @return The content, GetLength() bytes long, or nullptr if the stream is not in memory.
+         */
+        static const uint8_t *GetMemoryBuffer(IStream *stream);
+
         static uint64_t RoundUpToAlignment(uint64_t value, uint64_t alignment);
 
         static uint32_t RoundUpToAlignment(uint32_t value, uint32_t alignment);
@@ -1,25 +1,53 @@
+#include <algorithm>
+#include <cstddef>
+#include <vector>
 #include "../takamori/streams/IStream.h"
 #include "../takamori/streams/CBinaryReader.h"
+#include "../takamori/streams/CMemoryStream.h"
+#include "../takamori/streams/CFileStream.h"
+#include "../takamori/streams/CBinaryWriter.h"
 #include "../takamori/exceptions/CFormatException.h"
+#include "../takamori/CParallel.h"
+#include "../kawashima/hca/CHcaFormatReader.h"
 #include "CAcbHelper.h"
 #include "CAfs2Archive.h"
+#include "CCriFormatProbe.h"
+
+#ifdef _MSC_VER
+#undef max
+#undef min
+#endif
 
 using namespace cgss;
 
 static const uint8_t Afs2Signature[] = {0x41, 0x46, 0x53, 0x32}; // 'AFS2'
 static const int32_t InvalidCueId = -1;
 
-CAfs2Archive::CAfs2Archive(cgss::IStream *stream, uint64_t offset, const char *fileName, bool_t disposeStream) {
+CAfs2Archive::CAfs2Archive(cgss::IStream *stream, uint64_t offset, const char *fileName, bool_t disposeStream)
+    : MyClass(stream, offset, fileName, disposeStream, nullptr) {
+}
+
+CAfs2Archive::CAfs2Archive(IStream *stream, uint64_t offset, const char *fileName, bool_t disposeStream, CBinaryReader *indexReader) {
     _stream = stream;
     _streamOffset = offset;
     _disposeStream = disposeStream;
+    _hasHcaInfos = FALSE;
 
     const auto fileNameLength = strlen(fileName);
     _fileName = new char[fileNameLength + 1];
     memset(_fileName, 0, fileNameLength + 1);
     strncpy(_fileName, fileName, fileNameLength);
 
-    Initialize();
+    try {
+        if (indexReader) {
+            InitializeFromIndex(*indexReader);
+        } else {
+            Initialize();
+        }
+    } catch (...) {
+        delete[] _fileName;
+        throw;
+    }
 }
 
 CAfs2Archive::~CAfs2Archive() {
@@ -42,10 +70,14 @@ bool_t CAfs2Archive::IsAfs2Archive(IStream *stream, uint64_t offset) {
     CBinaryReader::PeekBytes(stream, fileSignature, 4, 0, 4);
     stream->SetPosition(pos);
 
+    return IsAfs2Archive(fileSignature);
+}
+
+bool_t CAfs2Archive::IsAfs2Archive(const uint8_t *magic) {
     bool_t b = TRUE;
 
     for (auto i = 0; i < 4; ++i) {
-        b = static_cast<bool_t>(b && fileSignature[i] == Afs2Signature[i]);
+        b = static_cast<bool_t>(b && magic[i] == Afs2Signature[i]);
     }
 
     return b;
@@ -86,12 +118,25 @@ void CAfs2Archive::Initialize() {
     auto prevCueId = InvalidCueId;
     auto fileOffsetFieldBase = 0x10 + fileCount * cueidFieldSize;
 
+    // The records are read from one copy of the header rather than with a seek each. Offsets are read as 32-bit
+    // values and masked, so the copy has room for that after the last offset.
+    const auto headerSize = static_cast<uint64_t>(fileOffsetFieldBase) + offsetFieldSize * (fileCount + 1) + 4;
+    CMemoryStream *headerStream = nullptr;
+    auto recordOffset = offset;
+
+    if (!CAcbHelper::GetMemoryBuffer(stream) && offset + headerSize <= stream->GetLength()) {
+        headerStream = CAcbHelper::ExtractToNewStream(stream, offset, static_cast<uint32_t>(headerSize));
+        recordOffset = 0;
+    }
+
+    CBinaryReader recordReader(headerStream ? static_cast<IStream *>(headerStream) : stream);
+
     for (uint32_t i = 0; i < fileCount; ++i) {
         auto currentOffsetFieldBase = fileOffsetFieldBase + offsetFieldSize * i;
         AFS2_FILE_RECORD record = {0};
 
-        record.cueId = reader.PeekUInt16LE(offset + (0x10 + cueidFieldSize * i));
-        record.fileOffsetRaw = reader.PeekUInt32LE(offset + currentOffsetFieldBase);
+        record.cueId = recordReader.PeekUInt16LE(recordOffset + (0x10 + cueidFieldSize * i));
+        record.fileOffsetRaw = recordReader.PeekUInt32LE(recordOffset + currentOffsetFieldBase);
 
         record.fileOffsetRaw &= offsetMask;
         record.fileOffsetRaw += offset;
@@ -99,7 +144,7 @@ void CAfs2Archive::Initialize() {
         record.fileOffsetAligned = CAcbHelper::RoundUpToAlignment(record.fileOffsetRaw, (uint64_t)GetByteAlignment());
 
         if (i == fileCount - 1) {
-            record.fileSize = reader.PeekUInt32LE(offset + currentOffsetFieldBase + offsetFieldSize) + offset - record.fileOffsetAligned;
+            record.fileSize = recordReader.PeekUInt32LE(recordOffset + currentOffsetFieldBase + offsetFieldSize) + offset - record.fileOffsetAligned;
         }
 
         if (prevCueId != InvalidCueId) {
@@ -111,12 +156,192 @@ void CAfs2Archive::Initialize() {
 
         prevCueId = record.cueId;
     }
+
+    delete headerStream;
 }
 
 const std::map<uint32_t, AFS2_FILE_RECORD> &CAfs2Archive::GetFiles() const {
     return _files;
 }
 
+std::map<uint32_t, HCA_INFO> CAfs2Archive::ReadHcaInfos(uint32_t threadCount) const {
+    if (_hasHcaInfos) {
+        return _hcaInfos;
+    }
+
+    auto stream = _stream;
+    std::vector<const AFS2_FILE_RECORD *> records;
+
+    records.reserve(_files.size());
+
+    for (auto &entry : _files) {
+        records.push_back(&entry.second);
+    }
+
+    const auto fileCount = static_cast<uint32_t>(records.size());
+    std::vector<HCA_INFO> infos(fileCount);
+    std::vector<bool_t> isHca(fileCount, FALSE);
+    const auto memory = CAcbHelper::GetMemoryBuffer(stream);
+    const auto fileStream = dynamic_cast<CFileStream *>(stream);
+    const auto isPositional = fileStream != nullptr && fileStream->IsPositional();
+    const auto length = memory ? stream->GetLength() : 0;
+    const auto pos = stream->GetPosition();
+
+    // Memory and positional file streams are read without the cursor, so headers are read in parallel.
+    // Other streams share one cursor and are read on the calling thread.
+    const auto readAt = [&](uint64_t position, uint8_t *buffer, uint32_t count) -> uint32_t {
+        if (memory) {
+            if (position >= length) {
+                return 0;
+            }
+
+            count = static_cast<uint32_t>(std::min<uint64_t>(count, length - position));
+            memcpy(buffer, memory + position, count);
+
+            return count;
+        }
+
+        if (isPositional) {
+            return fileStream->ReadAt(position, buffer, count, 0, count);
+        }
+
+        stream->Seek(position, StreamSeekOrigin::Begin);
+
+        return stream->Read(buffer, count, 0, count);
+    };
+
+    if (!memory && !isPositional) {
+        threadCount = 1;
+    }
+
+    CParallel::For(fileCount, threadCount, [&](uint32_t index) {
+        const auto &record = *records[index];
+        const auto fileSize = static_cast<uint32_t>(std::min<uint64_t>(record.fileSize, UINT32_MAX));
+        auto probeSize = fileSize;
+        if (probeSize > CCriFormatProbe::ProbeSize) {
+            probeSize = CCriFormatProbe::ProbeSize;
+        }
+        std::vector<uint8_t> header(probeSize);
+        auto headerRead = readAt(record.fileOffsetAligned, header.data(), probeSize);
+
+        // Long HCA headers (e.g. with a comment or padding) need another read.
+        const auto headerSize = std::min(CHcaFormatReader::GetHeaderSize(header.data(), headerRead), fileSize);
+
+        if (headerSize > headerRead && headerRead == header.size()) {
+            header.resize(headerSize);
+            headerRead += readAt(record.fileOffsetAligned + headerRead, header.data() + headerRead, headerSize - headerRead);
+        }
+
+        isHca[index] = static_cast<bool_t>(CCriFormatProbe::Probe(header.data(), headerRead, &infos[index]) == CriFormat::Hca);
+    });
+
+    stream->SetPosition(pos);
+
+    std::map<uint32_t, HCA_INFO> result;
+
+    for (uint32_t i = 0; i < fileCount; ++i) {
+        if (isHca[i]) {
+            result[records[i]->cueId] = infos[i];
+        }
+    }
+
+    return result;
+}
+
+// HCA information is written as the struct, without the unused part of the comment.
+static void WriteHcaInfo(CBinaryWriter &writer, const HCA_INFO &info) {
+    const auto commentOffset = static_cast<uint32_t>(offsetof(HCA_INFO, comment));
+    const auto restOffset = static_cast<uint32_t>(offsetof(HCA_INFO, fmtR01));
+
+    writer.Write(&info, sizeof(info), 0, commentOffset);
+    writer.Write(&info, sizeof(info), commentOffset, info.commentLength);
+    writer.Write(&info, sizeof(info), restOffset, sizeof(info) - restOffset);
+}
+
+static void ReadHcaInfo(CBinaryReader &reader, HCA_INFO &info) {
+    const auto commentOffset = static_cast<uint32_t>(offsetof(HCA_INFO, comment));
+    const auto restOffset = static_cast<uint32_t>(offsetof(HCA_INFO, fmtR01));
+
+    memset(&info, 0, sizeof(info));
+
+    auto read = reader.Read(&info, sizeof(info), 0, commentOffset);
+    read += reader.Read(&info, sizeof(info), commentOffset, info.commentLength);
+    read += reader.Read(&info, sizeof(info), restOffset, sizeof(info) - restOffset);
+
+    if (read != commentOffset + info.commentLength + sizeof(info) - restOffset) {
+        throw CFormatException("Unexpected end of AFS2 index.");
+    }
+}
+
+void CAfs2Archive::WriteIndex(CBinaryWriter &writer) {
+    if (!_hasHcaInfos) {
+        _hcaInfos = ReadHcaInfos(0);
+        _hasHcaInfos = TRUE;
+    }
+
+    writer.WriteUInt32LE(_version);
+    writer.WriteUInt32LE(_byteAlignment);
+    writer.WriteUInt16LE(_hcaKeyModifier);
+
+    writer.WriteUInt32LE(static_cast<uint32_t>(_files.size()));
+
+    for (auto &entry : _files) {
+        auto &record = entry.second;
+
+        writer.WriteUInt16LE(record.cueId);
+        writer.WriteUInt64LE(record.fileOffsetRaw);
+        writer.WriteUInt64LE(record.fileOffsetAligned);
+        writer.WriteUInt64LE(record.fileSize);
+    }
+
+    writer.WriteUInt32LE(static_cast<uint32_t>(_hcaInfos.size()));
+
+    for (auto &entry : _hcaInfos) {
+        writer.WriteUInt32LE(entry.first);
+        WriteHcaInfo(writer, entry.second);
+    }
+}
+
+CAfs2Archive *CAfs2Archive::ReadIndex(CBinaryReader &reader, IStream *stream, uint64_t offset, const char *fileName, bool_t disposeStream) {
+    return new CAfs2Archive(stream, offset, fileName, disposeStream, &reader);
+}
+
+void CAfs2Archive::InitializeFromIndex(CBinaryReader &reader) {
+    _version = reader.ReadUInt32LE();
+    _byteAlignment = reader.ReadUInt32LE();
+    _hcaKeyModifier = reader.ReadUInt16LE();
+
+    const auto fileCount = reader.ReadUInt32LE();
+
+    if (fileCount > 65535) {
+        throw CFormatException("File count exceeds max file entries.");
+    }
+
+    for (uint32_t i = 0; i < fileCount; ++i) {
+        AFS2_FILE_RECORD record = {0};
+
+        record.cueId = reader.ReadUInt16LE();
+        record.fileOffsetRaw = reader.ReadUInt64LE();
+        record.fileOffsetAligned = reader.ReadUInt64LE();
+        record.fileSize = reader.ReadUInt64LE();
+
+        _files[record.cueId] = record;
+    }
+
+    const auto hcaInfoCount = reader.ReadUInt32LE();
+
+    if (hcaInfoCount > fileCount) {
+        throw CFormatException("Invalid AFS2 index.");
+    }
+
+    for (uint32_t i = 0; i < hcaInfoCount; ++i) {
+        const auto cueId = reader.ReadUInt32LE();
+        ReadHcaInfo(reader, _hcaInfos[cueId]);
+    }
+
+    _hasHcaInfos = TRUE;
+}
+
 uint32_t CAfs2Archive::GetVersion() const {
     return _version;
 }
@@ -132,3 +357,7 @@ uint16_t CAfs2Archive::GetHcaKeyModifier() const {
 const char *CAfs2Archive::GetFileName() const {
     return _fileName;
 }
+
+IStream *CAfs2Archive::GetStream() const {
+    return _stream;
+}
@@ -3,11 +3,16 @@
 #include <map>
 #include "../cgss_env.h"
 #include "../cdata/AFS2_FILE_RECORD.h"
+#include "../cdata/HCA_INFO.h"
 
 CGSS_NS_BEGIN
 
     struct IStream;
 
+    class CBinaryReader;
+
+    class CBinaryWriter;
+
     class CGSS_EXPORT CAfs2Archive final {
 
     __root_class(CAfs2Archive);
@@ -20,8 +25,36 @@ CGSS_NS_BEGIN
 
         static bool_t IsAfs2Archive(IStream *stream, uint64_t offset);
 
+        /**
+         * Checks whether the first 4 bytes of an archive are the "AFS2" signature.
+         */
+        static bool_t IsAfs2Archive(const uint8_t *magic);
+
         const std::map<uint32_t, AFS2_FILE_RECORD> &GetFiles() const;
 
+        /**
+         * Reads the HCA headers of all files, without reading their audio data.
+         * @remarks Headers are read on up to threadCount threads if the archive stream is a memory stream, a mapped file
+         * or a positional file stream, and on the calling thread otherwise. The stream position is restored.
+         * @param threadCount Maximum number of threads. 0 means one per hardware thread.
+         * @return HCA information of the files that are HCA files, with the same keys as GetFiles().
+         * Nothing is read if the information was loaded from an index.
+         */
+        std::map<uint32_t, HCA_INFO> ReadHcaInfos(uint32_t threadCount) const;
+
+        /**
+         * Writes the file table and the HCA information of the files to an index.
+         * @remarks The HCA information is read with ReadHcaInfos() if it is not known yet, and kept for later calls.
+         * @see ReadIndex
+         */
+        void WriteIndex(CBinaryWriter &writer);
+
+        /**
+         * Creates an archive from an index written by WriteIndex(), without reading the archive.
+         * @remarks Throws if the index is malformed.
+         */
+        static CAfs2Archive *ReadIndex(CBinaryReader &reader, IStream *stream, uint64_t offset, const char *fileName, bool_t disposeStream);
+
         uint32_t GetByteAlignment() const;
 
         uint32_t GetVersion() const;
@@ -30,10 +63,16 @@ CGSS_NS_BEGIN
 
         const char *GetFileName() const;
 
+        IStream *GetStream() const;
+
     private:
 
+        CAfs2Archive(IStream *stream, uint64_t offset, const char *fileName, bool_t disposeStream, CBinaryReader *indexReader);
+
         void Initialize();
 
+        void InitializeFromIndex(CBinaryReader &reader);
+
         IStream *_stream;
         uint64_t _streamOffset;
         char *_fileName;
@@ -45,6 +84,9 @@ CGSS_NS_BEGIN
         uint16_t _hcaKeyModifier;
         uint32_t _version;
 
+        bool_t _hasHcaInfos;
+        std::map<uint32_t, HCA_INFO> _hcaInfos;
+
     };
 
 CGSS_NS_END
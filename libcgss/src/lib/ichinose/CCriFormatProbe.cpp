@@ -0,0 +1,86 @@
+#include <vector>
+#include "../takamori/streams/IStream.h"
+#include "../takamori/streams/CFileStream.h"
+#include "../kawashima/hca/CHcaFormatReader.h"
+#include "CUtfTable.h"
+#include "CAfs2Archive.h"
+#include "CCriFormatProbe.h"
+
+CGSS_NS_BEGIN
+
+    CriFormat CCriFormatProbe::Probe(const void *data, uint32_t dataSize, HCA_INFO *hcaInfo) {
+        if (!data || dataSize < 4) {
+            return CriFormat::Unknown;
+        }
+
+        const auto bytes = static_cast<const uint8_t *>(data);
+
+        if (CHcaFormatReader::GetHeaderSize(bytes, dataSize) > 0) {
+            HCA_INFO info;
+            if (!CHcaFormatReader::TryParseHeader(bytes, dataSize, info)) {
+                return CriFormat::Unknown;
+            }
+            if (hcaInfo) {
+                memcpy(hcaInfo, &info, sizeof(HCA_INFO));
+            }
+            return CriFormat::Hca;
+        }
+
+        if (CAfs2Archive::IsAfs2Archive(bytes)) {
+            return CriFormat::Afs2;
+        }
+
+        if (CUtfTable::IsUtfSignature(bytes)) {
+            return CriFormat::Utf;
+        }
+
+        return CriFormat::Unknown;
+    }
+
+    CriFormat CCriFormatProbe::Probe(IStream *stream, uint64_t offset, HCA_INFO *hcaInfo) {
+        if (!stream) {
+            return CriFormat::Unknown;
+        }
+
+        auto format = CriFormat::Unknown;
+
+        try {
+            const auto pos = stream->GetPosition();
+            uint8_t buffer[ProbeSize];
+
+            stream->Seek(offset, StreamSeekOrigin::Begin);
+            const auto read = stream->Read(buffer, ProbeSize, 0, ProbeSize);
+            const auto headerSize = CHcaFormatReader::GetHeaderSize(buffer, read);
+
+            if (headerSize > read) {
+                // Long HCA headers (e.g. with a comment or padding). Read the rest of them.
+                std::vector<uint8_t> headerContents(headerSize);
+                memcpy(headerContents.data(), buffer, read);
+                const auto restRead = stream->Read(headerContents.data(), headerSize, read, headerSize - read);
+                format = Probe(headerContents.data(), read + restRead, hcaInfo);
+            } else {
+                format = Probe(buffer, read, hcaInfo);
+            }
+
+            stream->SetPosition(pos);
+        } catch (...) {
+            format = CriFormat::Unknown;
+        }
+
+        return format;
+    }
+
+    CriFormat CCriFormatProbe::Probe(const char *fileName, HCA_INFO *hcaInfo) {
+        if (!fileName) {
+            return CriFormat::Unknown;
+        }
+
+        try {
+            CFileStream fileStream(fileName, FileMode::OpenExisting, FileAccess::Read);
+            return Probe(&fileStream, 0, hcaInfo);
+        } catch (...) {
+            return CriFormat::Unknown;
+        }
+    }
+
+CGSS_NS_END
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "../cgss_env.h"
+#include "../cgss_enum.h"
+#include "../cdata/HCA_INFO.h"
+
+CGSS_NS_BEGIN
+
+    struct IStream;
+
+    /**
+     * Tells HCA files, @UTF tables (ACB, ACF) and AFS2 archives (AWB) apart by their headers.
+     * @remarks Probing never throws and does not parse anything beyond the headers.
+     */
+    class CGSS_EXPORT CCriFormatProbe final {
+
+        PURE_STATIC(CCriFormatProbe);
+
+    public:
+
+        /**
+         * Probes data from the start of a file.
+         * @param data Data from the start of the file. For HCA files, it must cover the whole headers section.
+         * @param dataSize Size of the data, in bytes.
+         * @param hcaInfo Receives the HCA information if the data is an HCA file. Can be nullptr.
+         * @return Detected format, or CriFormat::Unknown.
+         */
+        static CriFormat Probe(const void *data, uint32_t dataSize, HCA_INFO *hcaInfo);
+
+        /**
+         * Probes a file in a stream with one read of ProbeSize bytes, plus one more if its HCA headers are longer.
+         * @remarks The stream position is restored.
+         * @param offset Offset of the file in the stream.
+         * @param hcaInfo Receives the HCA information if the file is an HCA file. Can be nullptr.
+         * @return Detected format, or CriFormat::Unknown (also when the stream cannot be read).
+         */
+        static CriFormat Probe(IStream *stream, uint64_t offset, HCA_INFO *hcaInfo);
+
+        /**
+         * Probes a file on disk.
+         * @see Probe(IStream *, uint64_t, HCA_INFO *)
+         */
+        static CriFormat Probe(const char *fileName, HCA_INFO *hcaInfo);
+
+        static const uint32_t ProbeSize = 512;
+
+    };
+
+CGSS_NS_END
@@ -71,6 +71,8 @@ CGSS_NS_BEGIN
         if (data && size > 0) {
             value.data.ptr = malloc(size);
             memcpy(value.data.ptr, data, size);
+        } else {
+            value.data.ptr = nullptr;
         }
         value.data.size = size;
         offset = fieldOffset;
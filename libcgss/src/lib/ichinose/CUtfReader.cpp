@@ -4,99 +4,101 @@
 
 CGSS_NS_BEGIN
 
+    // Keys are seed * increment^n modulo 256. From n = 8 on they repeat every 64 bytes: an even increment gives 0, and
+    // the order of an odd increment divides 64.
+    static const uint32_t KeyStreamPeriod = 64;
+
     CUtfReader::CUtfReader()
         : _encrypted(FALSE), _seed(0), _increment(0) {
-        _currentXor = 0;
-        _currentUtfOffset = 0;
-        _currentStringXor = 0;
-        _currentUtfStringOffset = 0;
     }
 
     CUtfReader::CUtfReader(uint8_t seed, uint8_t increment)
         : _encrypted(TRUE), _seed(seed), _increment(increment) {
-        _currentXor = 0;
-        _currentUtfOffset = 0;
-        _currentStringXor = 0;
-        _currentUtfStringOffset = 0;
     }
 
     bool_t CUtfReader::IsEncrypted() const {
         return _encrypted;
     }
 
-    void CUtfReader::PeekBytes(IStream *stream, uint8_t *buffer, uint64_t streamOffset, uint32_t size, uint64_t utfOffset) {
-        PeekBytes(stream, buffer, 0, streamOffset, size, utfOffset);
-    }
+    uint8_t CUtfReader::GetKey(uint64_t utfOffset) const {
+        uint8_t key = _seed;
+        uint8_t power = _increment;
 
-    void CUtfReader::PeekBytes(IStream *stream, uint8_t *buffer, uint64_t bufferOffset, uint64_t streamOffset, uint32_t size, uint64_t utfOffset) {
-        stream->Seek(streamOffset + utfOffset, StreamSeekOrigin::Begin);
+        for (auto n = utfOffset; n > 0; n >>= 1) {
+            if (n & 1) {
+                key *= power;
+            }
+            power *= power;
+        }
 
-        CBinaryReader::PeekBytes(stream, buffer, size, static_cast<size_t>(bufferOffset), size);
+        return key;
+    }
 
+    void CUtfReader::Decrypt(uint8_t *buffer, uint32_t size, uint64_t utfOffset) const {
         if (!IsEncrypted()) {
             return;
         }
 
-        if (utfOffset < _currentUtfOffset) {
-            _currentUtfOffset = 0;
+        auto key = GetKey(utfOffset);
+        const auto headSize = size < KeyStreamPeriod ? size : KeyStreamPeriod;
+
+        for (uint32_t i = 0; i < headSize; ++i) {
+            buffer[i] ^= key;
+            key *= _increment;
         }
 
-        if (_currentUtfOffset == 0) {
-            _currentXor = _seed;
+        if (size <= KeyStreamPeriod) {
+            return;
         }
 
-        for (auto j = _currentUtfOffset; j < utfOffset; ++j) {
-            if (j > 0) {
-                _currentXor *= _increment;
-            }
-            ++_currentUtfOffset;
+        // Past the first period every key is at n >= 64, so one period of keys covers the rest and the XOR
+        // runs on whole blocks, which compilers vectorize.
+        uint8_t keys[KeyStreamPeriod];
+
+        for (auto &k : keys) {
+            k = key;
+            key *= _increment;
         }
 
-        for (uint32_t i = 0; i < size; ++i) {
-            if (_currentUtfOffset != 0 || i > 0) {
-                _currentXor *= _increment;
+        for (auto i = KeyStreamPeriod; i < size; i += KeyStreamPeriod) {
+            const auto blockSize = size - i < KeyStreamPeriod ? size - i : KeyStreamPeriod;
+            auto *block = buffer + i;
+
+            for (uint32_t j = 0; j < blockSize; ++j) {
+                block[j] ^= keys[j];
             }
-            buffer[i] ^= _currentXor;
-            ++_currentUtfOffset;
         }
     }
 
-    uint8_t CUtfReader::PeekUInt8(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) {
+    void CUtfReader::PeekBytes(IStream *stream, uint8_t *buffer, uint64_t streamOffset, uint32_t size, uint64_t utfOffset) const {
+        PeekBytes(stream, buffer, 0, streamOffset, size, utfOffset);
+    }
+
+    void CUtfReader::PeekBytes(IStream *stream, uint8_t *buffer, uint64_t bufferOffset, uint64_t streamOffset, uint32_t size, uint64_t utfOffset) const {
+        stream->Seek(streamOffset + utfOffset, StreamSeekOrigin::Begin);
+
+        CBinaryReader::PeekBytes(stream, buffer, size, static_cast<size_t>(bufferOffset), size);
+
+        Decrypt(buffer + bufferOffset, size, utfOffset);
+    }
+
+    uint8_t CUtfReader::PeekUInt8(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) const {
         auto value = CBinaryReader::PeekUInt8(stream, streamOffset + utfOffset);
-        if (!IsEncrypted()) {
-            return value;
-        }
-        if (utfOffset < _currentUtfOffset) {
-            _currentUtfOffset = 0;
-        }
-        if (_currentUtfOffset == 0) {
-            _currentXor = _seed;
-        }
-        for (auto j = _currentUtfOffset; j < utfOffset; ++j) {
-            if (j > 0) {
-                _currentXor *= _increment;
-            }
-            ++_currentUtfOffset;
-        }
-        if (_currentUtfOffset != 0) {
-            _currentXor *= _increment;
-        }
-        value ^= _currentXor;
-        ++_currentUtfOffset;
+        Decrypt(&value, 1, utfOffset);
         return value;
     }
 
-    int8_t CUtfReader::PeekInt8(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) {
+    int8_t CUtfReader::PeekInt8(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) const {
         const auto u = PeekUInt8(stream, streamOffset, utfOffset);
         return *(int8_t *)&u;
     }
 
-    float CUtfReader::PeekSingle(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) {
+    float CUtfReader::PeekSingle(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) const {
         const auto i = PeekInt32(stream, streamOffset, utfOffset);
         return *(float *)&i;
     }
 
-    double CUtfReader::PeekDouble(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) {
+    double CUtfReader::PeekDouble(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) const {
         const auto i = PeekInt64(stream, streamOffset, utfOffset);
         return *(double *)&i;
     }
@@ -111,7 +113,7 @@ CGSS_NS_BEGIN
     }
 
 #define PEEK_FUNC(bit, u, U) \
-    u##int##bit##_t CUtfReader::Peek##U##Int##bit(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) { \
+    u##int##bit##_t CUtfReader::Peek##U##Int##bit(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) const { \
         uint8_t temp[((bit) / 8)]; \
         PeekBytes(stream, temp, streamOffset, ((bit) / 8), utfOffset); \
         if (CBitConverter::IsLittleEndian()) { \
@@ -17,41 +17,50 @@ CGSS_NS_BEGIN
 
         bool_t IsEncrypted() const;
 
-        void PeekBytes(IStream *stream, uint8_t *buffer, uint64_t streamOffset, uint32_t size, uint64_t utfOffset);
+        /**
+         * Decrypts bytes of the table in place.
+         * @remarks The key stream is computed from the offset directly, so any part of the table can be decrypted in any order.
+         * @param buffer Bytes to decrypt.
+         * @param size Number of bytes.
+         * @param utfOffset Offset of the first byte in the table.
+         */
+        void Decrypt(uint8_t *buffer, uint32_t size, uint64_t utfOffset) const;
 
-        void PeekBytes(IStream *stream, uint8_t *buffer, uint64_t bufferOffset, uint64_t streamOffset, uint32_t size, uint64_t utfOffset);
+        void PeekBytes(IStream *stream, uint8_t *buffer, uint64_t streamOffset, uint32_t size, uint64_t utfOffset) const;
 
-        uint8_t PeekUInt8(IStream *stream, uint64_t streamOffset, uint64_t utfOffset);
+        void PeekBytes(IStream *stream, uint8_t *buffer, uint64_t bufferOffset, uint64_t streamOffset, uint32_t size, uint64_t utfOffset) const;
 
-        int8_t PeekInt8(IStream *stream, uint64_t streamOffset, uint64_t utfOffset);
+        uint8_t PeekUInt8(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) const;
 
-        uint16_t PeekUInt16(IStream *stream, uint64_t streamOffset, uint64_t utfOffset);
+        int8_t PeekInt8(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) const;
 
-        int16_t PeekInt16(IStream *stream, uint64_t streamOffset, uint64_t utfOffset);
+        uint16_t PeekUInt16(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) const;
 
-        uint32_t PeekUInt32(IStream *stream, uint64_t streamOffset, uint64_t utfOffset);
+        int16_t PeekInt16(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) const;
 
-        int32_t PeekInt32(IStream *stream, uint64_t streamOffset, uint64_t utfOffset);
+        uint32_t PeekUInt32(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) const;
 
-        uint64_t PeekUInt64(IStream *stream, uint64_t streamOffset, uint64_t utfOffset);
+        int32_t PeekInt32(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) const;
 
-        int64_t PeekInt64(IStream *stream, uint64_t streamOffset, uint64_t utfOffset);
+        uint64_t PeekUInt64(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) const;
 
-        float PeekSingle(IStream *stream, uint64_t streamOffset, uint64_t utfOffset);
+        int64_t PeekInt64(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) const;
 
-        double PeekDouble(IStream *stream, uint64_t streamOffset, uint64_t utfOffset);
+        float PeekSingle(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) const;
+
+        double PeekDouble(IStream *stream, uint64_t streamOffset, uint64_t utfOffset) const;
 
     private:
 
+        /**
+         * Gets the key the byte at an offset of the table is XORed with, which is seed * increment^utfOffset.
+         */
+        uint8_t GetKey(uint64_t utfOffset) const;
+
         const bool_t _encrypted;
         const uint8_t _seed;
         const uint8_t _increment;
 
-        uint8_t _currentXor;
-        uint64_t _currentUtfOffset;
-        uint8_t _currentStringXor;
-        uint64_t _currentUtfStringOffset;
-
     };
 
 CGSS_NS_END
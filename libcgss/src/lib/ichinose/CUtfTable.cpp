@@ -2,7 +2,10 @@
 #include "../takamori/streams/CBinaryReader.h"
 #include "../takamori/exceptions/CFormatException.h"
 #include "../takamori/exceptions/CNotImplementedException.h"
+#include "../takamori/exceptions/CInvalidOperationException.h"
+#include "../takamori/exceptions/CArgumentException.h"
 #include "../takamori/streams/CStreamExtensions.h"
+#include "../takamori/streams/CSubStream.h"
 #include "CUtfTable.h"
 #include "CUtfReader.h"
 #include "CAcbHelper.h"
@@ -13,17 +16,59 @@ CGSS_NS_BEGIN
 
     uint8_t UTF_SIGNATURE[] = {'@', 'U', 'T', 'F'};
 
+    // Values in the table data are big endian.
+    static uint16_t ReadUInt16BE(const uint8_t *p) {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    static uint32_t ReadUInt32BE(const uint8_t *p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    static uint64_t ReadUInt64BE(const uint8_t *p) {
+        return (static_cast<uint64_t>(ReadUInt32BE(p)) << 32) | ReadUInt32BE(p + 4);
+    }
+
+    static uint32_t GetColumnValueSize(UtfColumnType type) {
+        switch (type) {
+            case UtfColumnType::U8:
+            case UtfColumnType::S8:
+                return 1;
+            case UtfColumnType::U16:
+            case UtfColumnType::S16:
+                return 2;
+            case UtfColumnType::U32:
+            case UtfColumnType::S32:
+            case UtfColumnType::R32:
+            case UtfColumnType::String:
+                return 4;
+            case UtfColumnType::U64:
+            case UtfColumnType::S64:
+            case UtfColumnType::R64:
+            case UtfColumnType::Data:
+                return 8;
+            default:
+                throw CFormatException("Unknown UTF table field type.");
+        }
+    }
+
     CUtfTable::CUtfTable(IStream *stream, uint64_t streamOffset)
-        : _stream(stream), _streamOffset(streamOffset) {
+        : _stream(stream), _streamOffset(streamOffset), _utfReader(nullptr), _tableDataStream(nullptr) {
         memset(_tableName, 0, sizeof(_tableName));
-        Initialize();
+
+        try {
+            Initialize();
+        } catch (...) {
+            delete _tableDataStream;
+            delete _utfReader;
+            throw;
+        }
     }
 
     CUtfTable::~CUtfTable() {
-        for (auto &row : _rows) {
-            for (auto pField : row.fields) {
-                delete pField;
-            }
+        if (_tableDataStream) {
+            delete _tableDataStream;
+            _tableDataStream = nullptr;
         }
 
         if (_utfReader) {
@@ -36,6 +81,10 @@ CGSS_NS_BEGIN
         return _stream;
     }
 
+    uint64_t CUtfTable::GetStreamOffset() const {
+        return _streamOffset;
+    }
+
     void CUtfTable::GetHeader(UTF_HEADER &header) const {
         memcpy(&header, &_utfHeader, sizeof(UTF_HEADER));
     }
@@ -48,10 +97,6 @@ CGSS_NS_BEGIN
         return _isEncrypted;
     }
 
-    const std::vector<CUtfTable::UtfRow> &CUtfTable::GetRows() const {
-        return _rows;
-    }
-
     const char *CUtfTable::GetName() const {
         return _tableName;
     }
@@ -77,18 +122,16 @@ CGSS_NS_BEGIN
             throw CFormatException("\"@UTF\" is not found.");
         }
 
-        auto *tableDataStream = GetTableDataStream();
+        _tableDataStream = GetTableDataStream();
         auto &header = _utfHeader;
 
-        ReadUtfHeader(tableDataStream, header, _tableName);
-
-        _rows.reserve(header.rowCount);
+        ReadUtfHeader(_tableDataStream, header, _tableName);
 
         if (header.tableSize > 0) {
-            InitializeUtfSchema(stream, tableDataStream, 0x20);
+            InitializeUtfSchema(0x20);
+        } else {
+            header.rowCount = 0;
         }
-
-        delete tableDataStream;
     }
 
     bool_t CUtfTable::CheckEncryption(const uint8_t *magic) {
@@ -108,19 +151,26 @@ CGSS_NS_BEGIN
         return TRUE;
     }
 
+    bool_t CUtfTable::IsUtfSignature(const uint8_t *magic) {
+        if (memcmp(magic, UTF_SIGNATURE, 4) == 0) {
+            return TRUE;
+        }
+        return GetKeysForEncryptedUtfTable(magic, nullptr, nullptr);
+    }
+
     bool_t CUtfTable::GetKeysForEncryptedUtfTable(const uint8_t *magic, uint8_t *seed, uint8_t *incr) {
         for (auto s = 0; s <= 0xff; ++s) {
             if ((magic[0] ^ s) != UTF_SIGNATURE[0]) {
                 continue;
             }
             for (auto i = 0; i <= 0xff; ++i) {
-                auto m = s * i;
+                auto m = static_cast<uint8_t>(s * i);
                 if ((magic[1] ^ m) != UTF_SIGNATURE[1]) {
                     continue;
                 }
                 auto t = i;
                 for (auto j = 2; j < 4; ++j) {
-                    m *= t;
+                    m = static_cast<uint8_t>(m * t);
                     if ((magic[j] ^ m) != UTF_SIGNATURE[j]) {
                         break;
                     }
@@ -144,38 +194,27 @@ CGSS_NS_BEGIN
         auto *stream = _stream;
         const auto streamOffset = _streamOffset;
         auto *reader = _utfReader;
-        const auto tableSize = reader->PeekUInt32(stream, streamOffset, 4) + 8;
-
-        if (!IsEncrypted()) {
-            return CAcbHelper::ExtractToNewStream(stream, streamOffset, tableSize);
+        auto tableSize = reader->PeekUInt32(stream, streamOffset, 4) + 8;
+        const auto extraDataOffset = reader->PeekUInt32(stream, streamOffset, 16) + 8;
+
+        // The values of data fields are at the end of the table and are read from the stream when asked for,
+        // so they are left out. In an ACB header they include the whole internal AWB. Encrypted tables are
+        // decrypted as a whole.
+        if (!IsEncrypted() && extraDataOffset >= 0x20 && extraDataOffset < tableSize) {
+            tableSize = extraDataOffset;
         }
 
-        auto originalPosition = stream->GetPosition();
-        uint32_t totalBytesRead = 0;
-
-        auto *memoryStream = new CMemoryStream(tableSize, FALSE);
-        uint32_t currentIndex = 0;
-        auto currentOffset = streamOffset;
-        uint8_t *buffer;
-
-        do {
-            auto shouldRead = tableSize - totalBytesRead;
-            buffer = static_cast<uint8_t *>(malloc(shouldRead));
-
-            _utfReader->PeekBytes(stream, buffer, 0, currentOffset, shouldRead, totalBytesRead);
-            memoryStream->Write(buffer, shouldRead, 0, shouldRead);
+        // A plain table in memory is used in place.
+        const auto *memoryBuffer = CAcbHelper::GetMemoryBuffer(stream);
 
-            // TODO: Actually this should be "+= buffer.length", but now CUtfReader::PeekBytes() does not return number of bytes read.
-            currentOffset += shouldRead;
-            currentIndex += shouldRead;
-            totalBytesRead += shouldRead;
-
-            free(buffer);
-        } while (totalBytesRead < tableSize);
+        if (!IsEncrypted() && memoryBuffer && streamOffset + tableSize <= stream->GetLength()) {
+            return new CMemoryStream(const_cast<uint8_t *>(memoryBuffer) + streamOffset, tableSize, FALSE);
+        }
 
-        stream->SetPosition(originalPosition);
+        auto *memoryStream = CAcbHelper::ExtractToNewStream(stream, streamOffset, tableSize);
 
-        memoryStream->Seek(0, StreamSeekOrigin::Begin);
+        // Decrypted once here, all later reads are from the plain table.
+        reader->Decrypt(memoryStream->GetBuffer(), tableSize, 0);
 
         return memoryStream;
     }
@@ -208,245 +247,422 @@ CGSS_NS_BEGIN
         stream->Seek(pos, StreamSeekOrigin::Begin);
     }
 
-    void CUtfTable::InitializeUtfSchema(IStream *sourceStream, CMemoryStream *tableDataStream, uint64_t schemaOffset) {
+    void CUtfTable::InitializeUtfSchema(uint64_t schemaOffset) {
         const auto &header = _utfHeader;
-        const auto baseOffset = _streamOffset;
-        auto &rows = _rows;
-        char fieldNameBuffer[UTF_FIELD_MAX_NAME_LEN] = {'\0'};
-
-        for (auto i = 0; i < header.rowCount; ++i) {
-            auto currentStreamOffset = schemaOffset;
-            UtfRow row;
-            uint32_t currentRowOffset = 0;
-            row.baseOffset = header.perRowDataOffset + header.rowSize * i;
-
-            for (auto j = 0; j < header.fieldCount; ++j) {
-                auto field = new CUtfField();
-                const auto columnType = CBinaryReader::PeekUInt8(tableDataStream, currentStreamOffset);
-                const auto nameOffset = CBinaryReader::PeekInt32BE(tableDataStream, currentStreamOffset + 1);
-                const auto pos = tableDataStream->GetPosition();
-                tableDataStream->Seek(header.stringTableOffset + nameOffset, StreamSeekOrigin::Begin);
-                CStreamExtensions::ReadNullEndedString(tableDataStream, fieldNameBuffer, sizeof(fieldNameBuffer));
-                field->SetName(fieldNameBuffer);
-                tableDataStream->Seek(pos, StreamSeekOrigin::Begin);
-
-                const auto storage = static_cast<UtfColumnStorage>(columnType & CGSS_UTF_COLUMN_STORAGE_MASK);
-                const auto type = static_cast<UtfColumnType>(columnType & CGSS_UTF_COLUMN_TYPE_MASK);
-
-                field->type = static_cast<CGSS_UTF_COLUMN_TYPE>(type);
-                field->storage = static_cast<CGSS_UTF_COLUMN_STORAGE>(storage);
-
-                switch (storage) {
-                    case UtfColumnStorage::Const:
-                    case UtfColumnStorage::Const2: {
-                        const auto constantOffset = static_cast<uint32_t>(currentStreamOffset) + 5;
-                        field->offsetInRow = 0; // constant
-
-                        switch (type) {
-                            case UtfColumnType::U8:
-                                field->SetValue(CBinaryReader::PeekUInt8(tableDataStream, constantOffset), constantOffset);
-                                currentStreamOffset += 1;
-                                break;
-                            case UtfColumnType::S8:
-                                field->SetValue(CBinaryReader::PeekInt8(tableDataStream, constantOffset), constantOffset);
-                                currentStreamOffset += 1;
-                                break;
-                            case UtfColumnType::U16:
-                                field->SetValue(CBinaryReader::PeekUInt16BE(tableDataStream, constantOffset), constantOffset);
-                                currentStreamOffset += 2;
-                                break;
-                            case UtfColumnType::S16:
-                                field->SetValue(CBinaryReader::PeekInt16BE(tableDataStream, constantOffset), constantOffset);
-                                currentStreamOffset += 2;
-                                break;
-                            case UtfColumnType::U32:
-                                field->SetValue(CBinaryReader::PeekUInt32BE(tableDataStream, constantOffset), constantOffset);
-                                currentStreamOffset += 4;
-                                break;
-                            case UtfColumnType::S32:
-                                field->SetValue(CBinaryReader::PeekInt32BE(tableDataStream, constantOffset), constantOffset);
-                                currentStreamOffset += 4;
-                                break;
-                            case UtfColumnType::U64:
-                                field->SetValue(CBinaryReader::PeekUInt64BE(tableDataStream, constantOffset), constantOffset);
-                                currentStreamOffset += 8;
-                                break;
-                            case UtfColumnType::S64:
-                                field->SetValue(CBinaryReader::PeekInt64BE(tableDataStream, constantOffset), constantOffset);
-                                currentStreamOffset += 8;
-                                break;
-                            case UtfColumnType::R32:
-                                field->SetValue(CBinaryReader::PeekSingleBE(tableDataStream, constantOffset), constantOffset);
-                                currentStreamOffset += 4;
-                                break;
-                            case UtfColumnType::R64:
-                                field->SetValue(CBinaryReader::PeekDoubleBE(tableDataStream, constantOffset), constantOffset);
-                                currentStreamOffset += 8;
-                                break;
-                            case UtfColumnType::String: {
-                                const auto dataOffset = CBinaryReader::PeekUInt32BE(tableDataStream, constantOffset);
-                                const auto fieldDataOffset = header.stringTableOffset + dataOffset;
-                                const auto *str = reinterpret_cast<const char *>(tableDataStream->GetBuffer()) + fieldDataOffset;
-                                field->SetValue(str, dataOffset);
-                                currentStreamOffset += 4;
-                                break;
-                            }
-                            case UtfColumnType::Data: {
-                                const auto dataOffset = CBinaryReader::PeekUInt32BE(tableDataStream, constantOffset);
-                                const auto dataSize = CBinaryReader::PeekUInt32BE(tableDataStream, constantOffset + 4);
-                                const auto fieldDataOffset = static_cast<uint32_t>(baseOffset) + header.extraDataOffset + dataOffset;
-                                if (dataSize > 0) {
-                                    auto dataBuffer = static_cast<uint8_t *>(malloc(dataSize));
-                                    memset(dataBuffer, 0, dataSize);
-                                    sourceStream->Seek(fieldDataOffset, StreamSeekOrigin::Begin);
-                                    sourceStream->Read(dataBuffer, dataSize, 0, dataSize);
-                                    field->SetValue(dataBuffer, dataSize, fieldDataOffset);
-                                    free(dataBuffer);
-                                } else {
-                                    field->SetValue(nullptr, dataSize, fieldDataOffset);
-                                }
-                                currentStreamOffset += 8;
-                                break;
-                            }
-                            default:
-                                throw CFormatException("Unknown UTF table field type.");
-                        }
-                        break;
-                    }
-                    case UtfColumnStorage::PerRow: {
-                        auto fieldDataOffset = row.baseOffset + currentRowOffset;
-                        field->offsetInRow = currentRowOffset;
-
-                        switch (type) {
-                            case UtfColumnType::U8:
-                                field->SetValue(CBinaryReader::PeekUInt8(tableDataStream, fieldDataOffset), fieldDataOffset);
-                                currentRowOffset += 1;
-                                break;
-                            case UtfColumnType::S8:
-                                field->SetValue(CBinaryReader::PeekInt8(tableDataStream, fieldDataOffset), fieldDataOffset);
-                                currentRowOffset += 1;
-                                break;
-                            case UtfColumnType::U16:
-                                field->SetValue(CBinaryReader::PeekUInt16BE(tableDataStream, fieldDataOffset), fieldDataOffset);
-                                currentRowOffset += 2;
-                                break;
-                            case UtfColumnType::S16:
-                                field->SetValue(CBinaryReader::PeekInt16BE(tableDataStream, fieldDataOffset), fieldDataOffset);
-                                currentRowOffset += 2;
-                                break;
-                            case UtfColumnType::U32:
-                                field->SetValue(CBinaryReader::PeekUInt32BE(tableDataStream, fieldDataOffset), fieldDataOffset);
-                                currentRowOffset += 4;
-                                break;
-                            case UtfColumnType::S32:
-                                field->SetValue(CBinaryReader::PeekInt32BE(tableDataStream, fieldDataOffset), fieldDataOffset);
-                                currentRowOffset += 4;
-                                break;
-                            case UtfColumnType::U64:
-                                field->SetValue(CBinaryReader::PeekInt64BE(tableDataStream, fieldDataOffset), fieldDataOffset);
-                                currentRowOffset += 8;
-                                break;
-                            case UtfColumnType::S64:
-                                field->SetValue(CBinaryReader::PeekInt64BE(tableDataStream, fieldDataOffset), fieldDataOffset);
-                                currentRowOffset += 8;
-                                break;
-                            case UtfColumnType::R32:
-                                field->SetValue(CBinaryReader::PeekSingleBE(tableDataStream, fieldDataOffset), fieldDataOffset);
-                                currentRowOffset += 4;
-                                break;
-                            case UtfColumnType::R64:
-                                field->SetValue(CBinaryReader::PeekDoubleBE(tableDataStream, fieldDataOffset), fieldDataOffset);
-                                currentRowOffset += 8;
-                                break;
-                            case UtfColumnType::String: {
-                                const auto rowDataOffset = CBinaryReader::PeekUInt32BE(tableDataStream, row.baseOffset + currentRowOffset);
-                                fieldDataOffset = header.stringTableOffset + rowDataOffset;
-                                const auto *str = reinterpret_cast<const char *>(tableDataStream->GetBuffer()) + fieldDataOffset;
-                                field->SetValue(str, fieldDataOffset);
-                                currentRowOffset += 4;
-                                break;
-                            }
-                            case UtfColumnType::Data: {
-                                const auto rowDataOffset = CBinaryReader::PeekUInt32BE(tableDataStream, row.baseOffset + currentRowOffset);
-                                const auto dataSize = CBinaryReader::PeekUInt32BE(tableDataStream, row.baseOffset + currentRowOffset + 4);
-                                fieldDataOffset = static_cast<uint32_t>(baseOffset) + header.extraDataOffset + rowDataOffset;
-                                if (dataSize > 0) {
-                                    auto dataBuffer = static_cast<uint8_t *>(malloc(dataSize));
-                                    memset(dataBuffer, 0, dataSize);
-                                    sourceStream->Seek(fieldDataOffset, StreamSeekOrigin::Begin);
-                                    sourceStream->Read(dataBuffer, dataSize, 0, dataSize);
-                                    field->SetValue(dataBuffer, dataSize, fieldDataOffset);
-                                    free(dataBuffer);
-                                } else {
-                                    field->SetValue(nullptr, dataSize, fieldDataOffset);
-                                }
-                                currentRowOffset += 8;
-                                break;
-                            }
-                            default:
-                                throw CFormatException("Unknown UTF table field type.");
-                        }
-                        break;
+        const auto *tableData = _tableDataStream->GetBuffer();
+        const auto tableDataSize = _tableDataStream->GetLength();
+        auto &columns = _columns;
+
+        // Names and string values must end inside the table data.
+        const auto isValidString = [tableData, tableDataSize](uint64_t offset) {
+            return offset < tableDataSize && memchr(tableData + offset, 0, static_cast<size_t>(tableDataSize - offset)) != nullptr;
+        };
+
+        columns.reserve(header.fieldCount);
+        _columnIndices.reserve(header.fieldCount);
+
+        auto currentOffset = schemaOffset;
+        uint32_t currentRowOffset = 0;
+
+        for (auto j = 0; j < header.fieldCount; ++j) {
+            if (currentOffset + 5 > tableDataSize) {
+                throw CFormatException("UTF table schema is out of range.");
+            }
+
+            const auto columnType = tableData[currentOffset];
+            const auto nameOffset = static_cast<uint64_t>(header.stringTableOffset) + ReadUInt32BE(tableData + currentOffset + 1);
+
+            if (!isValidString(nameOffset)) {
+                throw CFormatException("UTF table field name is out of range.");
+            }
+
+            UtfColumn column;
+            column.name = reinterpret_cast<const char *>(tableData + nameOffset);
+            column.storage = static_cast<UtfColumnStorage>(columnType & CGSS_UTF_COLUMN_STORAGE_MASK);
+            column.type = static_cast<UtfColumnType>(columnType & CGSS_UTF_COLUMN_TYPE_MASK);
+
+            const auto valueSize = GetColumnValueSize(column.type);
+
+            currentOffset += 5;
+
+            switch (column.storage) {
+                case UtfColumnStorage::Zero:
+                    column.offset = 0;
+                    break;
+                case UtfColumnStorage::Const:
+                case UtfColumnStorage::Const2:
+                    column.offset = static_cast<uint32_t>(currentOffset);
+                    currentOffset += valueSize;
+                    if (currentOffset > tableDataSize) {
+                        throw CFormatException("UTF table schema is out of range.");
                     }
-                    default:
-                        throw CFormatException("Unknown UTF table field storage format.");
-                }
+                    break;
+                case UtfColumnStorage::PerRow:
+                    column.offset = currentRowOffset;
+                    currentRowOffset += valueSize;
+                    break;
+                default:
+                    throw CFormatException("Unknown UTF table field storage format.");
+            }
+
+            columns.push_back(column);
+
+            // The first column wins if names repeat.
+            _columnIndices.emplace(column.name, static_cast<uint32_t>(j));
+        }
 
-                row.fields.push_back(field);
+        if (header.rowCount > 0) {
+            const auto rowsEnd = static_cast<uint64_t>(header.perRowDataOffset) + static_cast<uint64_t>(header.rowSize) * header.rowCount;
 
-                currentStreamOffset += 5;
+            if (currentRowOffset > header.rowSize || rowsEnd > tableDataSize) {
+                throw CFormatException("UTF table rows are out of range.");
             }
+        }
+    }
+
+    uint32_t CUtfTable::GetRowCount() const {
+        return _utfHeader.rowCount;
+    }
+
+    uint32_t CUtfTable::GetColumnCount() const {
+        return static_cast<uint32_t>(_columns.size());
+    }
+
+    int32_t CUtfTable::GetColumnIndex(const char *columnName) const {
+        const auto it = _columnIndices.find(columnName);
+
+        return it != _columnIndices.end() ? static_cast<int32_t>(it->second) : -1;
+    }
 
-            rows.push_back(row);
+    size_t CUtfTable::ColumnNameHash::operator()(const char *name) const {
+        // FNV-1a
+        size_t hash = static_cast<size_t>(2166136261u);
+
+        for (; *name; ++name) {
+            hash = (hash ^ static_cast<uint8_t>(*name)) * static_cast<size_t>(16777619u);
         }
+
+        return hash;
     }
 
-    bool_t CUtfTable::GetFieldOffset(uint32_t rowIndex, const char *fieldName, uint64_t *offset) {
-        if (rowIndex >= _rows.size()) {
-            if (offset) {
-                *offset = 0;
-            }
+    bool CUtfTable::ColumnNameEqual::operator()(const char *left, const char *right) const {
+        return strcmp(left, right) == 0;
+    }
+
+    const char *CUtfTable::GetColumnName(uint32_t columnIndex) const {
+        return columnIndex < _columns.size() ? _columns[columnIndex].name : nullptr;
+    }
+
+    UtfColumnType CUtfTable::GetColumnType(uint32_t columnIndex) const {
+        if (columnIndex >= _columns.size()) {
+            throw CArgumentException("CUtfTable::GetColumnType()");
+        }
+
+        return _columns[columnIndex].type;
+    }
+
+    UtfColumnStorage CUtfTable::GetColumnStorage(uint32_t columnIndex) const {
+        if (columnIndex >= _columns.size()) {
+            throw CArgumentException("CUtfTable::GetColumnStorage()");
+        }
+
+        return _columns[columnIndex].storage;
+    }
 
+    bool_t CUtfTable::GetFieldValuePointer(uint32_t rowIndex, uint32_t columnIndex, const uint8_t **data) const {
+        if (rowIndex >= _utfHeader.rowCount || columnIndex >= _columns.size()) {
+            *data = nullptr;
             return FALSE;
         }
 
-        const auto &row = _rows[rowIndex];
+        const auto &column = _columns[columnIndex];
+        const auto *tableData = _tableDataStream->GetBuffer();
+
+        switch (column.storage) {
+            case UtfColumnStorage::PerRow:
+                *data = tableData + _utfHeader.perRowDataOffset + static_cast<uint64_t>(_utfHeader.rowSize) * rowIndex + column.offset;
+                break;
+            case UtfColumnStorage::Const:
+            case UtfColumnStorage::Const2:
+                *data = tableData + column.offset;
+                break;
+            default:
+                *data = nullptr;
+                break;
+        }
 
-        for (auto &field : row.fields) {
-            if (strcmp(fieldName, field->name) == 0) {
-                if (offset) {
-                    *offset = field->offset;
-                }
+        return TRUE;
+    }
 
-                return TRUE;
+    template<typename T>
+    bool_t CUtfTable::GetFieldNumber(uint32_t rowIndex, uint32_t columnIndex, T *value) const {
+        *value = 0;
+
+        const uint8_t *data;
+
+        if (!GetFieldValuePointer(rowIndex, columnIndex, &data)) {
+            return FALSE;
+        }
+
+        const auto type = _columns[columnIndex].type;
+
+        if (type == UtfColumnType::String || type == UtfColumnType::Data) {
+            throw CInvalidOperationException("Unsupported field type for retrieving numeric value.");
+        }
+
+        if (!data) {
+            return TRUE;
+        }
+
+        switch (type) {
+            case UtfColumnType::U8:
+                *value = static_cast<T>(data[0]);
+                break;
+            case UtfColumnType::S8:
+                *value = static_cast<T>(static_cast<int8_t>(data[0]));
+                break;
+            case UtfColumnType::U16:
+                *value = static_cast<T>(ReadUInt16BE(data));
+                break;
+            case UtfColumnType::S16:
+                *value = static_cast<T>(static_cast<int16_t>(ReadUInt16BE(data)));
+                break;
+            case UtfColumnType::U32:
+                *value = static_cast<T>(ReadUInt32BE(data));
+                break;
+            case UtfColumnType::S32:
+                *value = static_cast<T>(static_cast<int32_t>(ReadUInt32BE(data)));
+                break;
+            case UtfColumnType::U64:
+                *value = static_cast<T>(ReadUInt64BE(data));
+                break;
+            case UtfColumnType::S64:
+                *value = static_cast<T>(static_cast<int64_t>(ReadUInt64BE(data)));
+                break;
+            case UtfColumnType::R32: {
+                const auto i = ReadUInt32BE(data);
+                float f;
+                memcpy(&f, &i, sizeof(f));
+                *value = static_cast<T>(f);
+                break;
             }
+            case UtfColumnType::R64: {
+                const auto i = ReadUInt64BE(data);
+                double d;
+                memcpy(&d, &i, sizeof(d));
+                *value = static_cast<T>(d);
+                break;
+            }
+            default:
+                break;
         }
 
-        return FALSE;
+        return TRUE;
     }
 
-    bool_t CUtfTable::GetFieldSize(uint32_t rowIndex, const char *fieldName, uint32_t *size) {
-        if (rowIndex >= _rows.size()) {
-            if (size) {
-                *size = 0;
-            }
+#define GET_FIELD_VALUE_FUNC(type) \
+    bool_t CUtfTable::GetFieldValue(uint32_t rowIndex, uint32_t columnIndex, type *value) const { \
+        return GetFieldNumber(rowIndex, columnIndex, value); \
+    }
+
+    GET_FIELD_VALUE_FUNC(uint8_t)
+
+    GET_FIELD_VALUE_FUNC(int8_t)
+
+    GET_FIELD_VALUE_FUNC(uint16_t)
+
+    GET_FIELD_VALUE_FUNC(int16_t)
 
+    GET_FIELD_VALUE_FUNC(uint32_t)
+
+    GET_FIELD_VALUE_FUNC(int32_t)
+
+    GET_FIELD_VALUE_FUNC(uint64_t)
+
+    GET_FIELD_VALUE_FUNC(int64_t)
+
+    GET_FIELD_VALUE_FUNC(float)
+
+    GET_FIELD_VALUE_FUNC(double)
+
+    const char *CUtfTable::GetFieldString(uint32_t rowIndex, uint32_t columnIndex) const {
+        const uint8_t *data;
+
+        if (!GetFieldValuePointer(rowIndex, columnIndex, &data) || !data || _columns[columnIndex].type != UtfColumnType::String) {
+            return nullptr;
+        }
+
+        const auto *tableData = _tableDataStream->GetBuffer();
+        const auto tableDataSize = _tableDataStream->GetLength();
+        const auto stringOffset = static_cast<uint64_t>(_utfHeader.stringTableOffset) + ReadUInt32BE(data);
+
+        if (stringOffset >= tableDataSize || !memchr(tableData + stringOffset, 0, static_cast<size_t>(tableDataSize - stringOffset))) {
+            return nullptr;
+        }
+
+        return reinterpret_cast<const char *>(tableData + stringOffset);
+    }
+
+    bool_t CUtfTable::GetFieldDataRange(uint32_t rowIndex, uint32_t columnIndex, uint64_t *offset, uint32_t *size) const {
+        if (columnIndex >= _columns.size() || _columns[columnIndex].type != UtfColumnType::Data) {
+            *offset = 0;
+            *size = 0;
             return FALSE;
         }
 
-        const auto &row = _rows[rowIndex];
+        return GetFieldLocation(rowIndex, columnIndex, offset, size);
+    }
+
+    IStream *CUtfTable::OpenFieldDataStream(uint32_t rowIndex, uint32_t columnIndex) const {
+        uint64_t offset;
+        uint32_t size;
+
+        if (!GetFieldDataRange(rowIndex, columnIndex, &offset, &size)) {
+            return nullptr;
+        }
+
+        auto *source = GetFieldDataSource(offset);
 
-        for (auto &field : row.fields) {
-            if (strcmp(fieldName, field->name) == 0) {
-                if (size) {
-                    *size = field->value.data.size;
+        return new CSubStream(source, offset, size);
+    }
+
+    IStream *CUtfTable::GetFieldDataSource(uint64_t &offset) const {
+        if (!IsEncrypted()) {
+            return _stream;
+        }
+
+        offset -= _streamOffset;
+
+        return _tableDataStream;
+    }
+
+    bool_t CUtfTable::GetFieldLocation(uint32_t rowIndex, uint32_t columnIndex, uint64_t *offset, uint32_t *size) const {
+        *offset = 0;
+        *size = 0;
+
+        const uint8_t *data;
+
+        if (!GetFieldValuePointer(rowIndex, columnIndex, &data)) {
+            return FALSE;
+        }
+
+        if (!data) {
+            return TRUE;
+        }
+
+        const auto &column = _columns[columnIndex];
+        const auto *tableData = _tableDataStream->GetBuffer();
+
+        switch (column.type) {
+            case UtfColumnType::String:
+                // Constant strings are located in the string table, per-row strings in the table data.
+                *offset = ReadUInt32BE(data);
+                if (column.storage == UtfColumnStorage::PerRow) {
+                    *offset += _utfHeader.stringTableOffset;
                 }
+                break;
+            case UtfColumnType::Data:
+                *offset = _streamOffset + _utfHeader.extraDataOffset + ReadUInt32BE(data);
+                *size = ReadUInt32BE(data + 4);
+                break;
+            default:
+                *offset = static_cast<uint64_t>(data - tableData);
+                break;
+        }
 
-                return TRUE;
+        return TRUE;
+    }
+
+    void CUtfTable::GetField(uint32_t rowIndex, uint32_t columnIndex, CUtfField &field) const {
+        if (rowIndex >= _utfHeader.rowCount || columnIndex >= _columns.size()) {
+            throw CArgumentException("CUtfTable::GetField()");
+        }
+
+        const auto &column = _columns[columnIndex];
+        uint64_t offset;
+        uint32_t size;
+
+        GetFieldLocation(rowIndex, columnIndex, &offset, &size);
+
+        const auto fieldOffset = static_cast<uint32_t>(offset);
+
+        switch (column.type) {
+#define SET_NUMBER(t) { \
+                t v; \
+                GetFieldNumber(rowIndex, columnIndex, &v); \
+                field.SetValue(v, fieldOffset); \
+                break; \
             }
+            case UtfColumnType::U8:
+                SET_NUMBER(uint8_t)
+            case UtfColumnType::S8:
+                SET_NUMBER(int8_t)
+            case UtfColumnType::U16:
+                SET_NUMBER(uint16_t)
+            case UtfColumnType::S16:
+                SET_NUMBER(int16_t)
+            case UtfColumnType::U32:
+                SET_NUMBER(uint32_t)
+            case UtfColumnType::S32:
+                SET_NUMBER(int32_t)
+            case UtfColumnType::U64:
+                SET_NUMBER(uint64_t)
+            case UtfColumnType::S64:
+                SET_NUMBER(int64_t)
+            case UtfColumnType::R32:
+                SET_NUMBER(float)
+            case UtfColumnType::R64:
+                SET_NUMBER(double)
+#undef SET_NUMBER
+            case UtfColumnType::String:
+                field.SetValue(GetFieldString(rowIndex, columnIndex), fieldOffset);
+                break;
+            case UtfColumnType::Data:
+                if (size > 0) {
+                    auto dataBuffer = static_cast<uint8_t *>(malloc(size));
+                    memset(dataBuffer, 0, size);
+                    auto *source = GetFieldDataSource(offset);
+                    source->Seek(offset, StreamSeekOrigin::Begin);
+                    source->Read(dataBuffer, size, 0, size);
+                    field.SetValue(dataBuffer, size, fieldOffset);
+                    free(dataBuffer);
+                } else {
+                    field.SetValue(nullptr, size, fieldOffset);
+                }
+                break;
+            default:
+                break;
         }
 
-        return FALSE;
+        field.SetName(column.name);
+        field.storage = static_cast<CGSS_UTF_COLUMN_STORAGE>(column.storage);
+        field.offsetInRow = column.storage == UtfColumnStorage::PerRow ? column.offset : 0;
+    }
+
+    bool_t CUtfTable::GetFieldOffset(uint32_t rowIndex, const char *fieldName, uint64_t *offset) const {
+        uint64_t fieldOffset;
+        uint32_t fieldSize;
+        const auto columnIndex = GetColumnIndex(fieldName);
+        const auto found = columnIndex >= 0 && GetFieldLocation(rowIndex, static_cast<uint32_t>(columnIndex), &fieldOffset, &fieldSize);
+
+        if (offset) {
+            *offset = found ? fieldOffset : 0;
+        }
+
+        return found;
+    }
+
+    bool_t CUtfTable::GetFieldSize(uint32_t rowIndex, const char *fieldName, uint32_t *size) const {
+        uint64_t fieldOffset;
+        uint32_t fieldSize;
+        const auto columnIndex = GetColumnIndex(fieldName);
+        const auto found = columnIndex >= 0 && GetFieldLocation(rowIndex, static_cast<uint32_t>(columnIndex), &fieldOffset, &fieldSize);
+
+        if (size) {
+            *size = found ? fieldSize : 0;
+        }
+
+        return found;
     }
 
 CGSS_NS_END
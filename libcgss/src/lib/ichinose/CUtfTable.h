@@ -3,7 +3,9 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include "../cgss_env.h"
+#include "../cgss_enum.h"
 #include "../takamori/streams/IStream.h"
 #include "../cdata/UTF_HEADER.h"
 #include "../cdata/UTF_FIELD.h"
@@ -15,6 +17,12 @@ CGSS_NS_BEGIN
 
     class CMemoryStream;
 
+    class CUtfField;
+
+    /**
+     * A @UTF table. The schema is parsed once when the table is opened; values are read from the table data
+     * only when they are asked for.
+     */
     class CGSS_EXPORT CUtfTable {
 
     __root_class(CUtfTable);
@@ -31,27 +39,95 @@ CGSS_NS_BEGIN
 
         IStream *GetStream() const;
 
+        uint64_t GetStreamOffset() const;
+
         bool_t IsEncrypted() const;
 
-        typedef struct {
-            uint32_t baseOffset;
-            std::vector<class CUtfField *> fields;
-        } UtfRow;
+        const char *GetName() const;
 
-        const std::vector<CUtfTable::UtfRow> &GetRows() const;
+        uint32_t GetRowCount() const;
 
-        const char *GetName() const;
+        uint32_t GetColumnCount() const;
+
+        /**
+         * Finds a column by name, in constant time.
+         * @remarks Resolve the columns once and read fields by index in loops over rows.
+         * @return Index of the column, or -1 if the table has no such column.
+         */
+        int32_t GetColumnIndex(const char *columnName) const;
+
+        const char *GetColumnName(uint32_t columnIndex) const;
+
+        UtfColumnType GetColumnType(uint32_t columnIndex) const;
+
+        UtfColumnStorage GetColumnStorage(uint32_t columnIndex) const;
+
+        /**
+         * Reads a numeric field, converted to the type of the output.
+         * @param value Receives the value, or 0 if the function returns FALSE.
+         * @return FALSE if the row or the column does not exist.
+         * @throws CInvalidOperationException The column is a string or data column.
+         */
+        bool_t GetFieldValue(uint32_t rowIndex, uint32_t columnIndex, uint8_t *value) const;
+
+        bool_t GetFieldValue(uint32_t rowIndex, uint32_t columnIndex, int8_t *value) const;
+
+        bool_t GetFieldValue(uint32_t rowIndex, uint32_t columnIndex, uint16_t *value) const;
+
+        bool_t GetFieldValue(uint32_t rowIndex, uint32_t columnIndex, int16_t *value) const;
+
+        bool_t GetFieldValue(uint32_t rowIndex, uint32_t columnIndex, uint32_t *value) const;
+
+        bool_t GetFieldValue(uint32_t rowIndex, uint32_t columnIndex, int32_t *value) const;
+
+        bool_t GetFieldValue(uint32_t rowIndex, uint32_t columnIndex, uint64_t *value) const;
 
-        bool_t GetFieldOffset(uint32_t rowIndex, const char *fieldName, uint64_t *offset);
+        bool_t GetFieldValue(uint32_t rowIndex, uint32_t columnIndex, int64_t *value) const;
 
-        bool_t GetFieldSize(uint32_t rowIndex, const char *fieldName, uint32_t *size);
+        bool_t GetFieldValue(uint32_t rowIndex, uint32_t columnIndex, float *value) const;
+
+        bool_t GetFieldValue(uint32_t rowIndex, uint32_t columnIndex, double *value) const;
+
+        /**
+         * Reads a string field.
+         * @return The string, which stays valid as long as the table, or nullptr if the field does not exist
+         * or is not a string.
+         */
+        const char *GetFieldString(uint32_t rowIndex, uint32_t columnIndex) const;
+
+        /**
+         * Gets where the value of a data field is in the stream, without reading it.
+         * @remarks In an encrypted table the bytes there are encrypted. OpenFieldDataStream() gives the decrypted value.
+         * @return FALSE if the field does not exist or is not a data field.
+         */
+        bool_t GetFieldDataRange(uint32_t rowIndex, uint32_t columnIndex, uint64_t *offset, uint32_t *size) const;
+
+        /**
+         * Opens the value of a data field as a read-only view of the stream, without copying it. The caller deletes the view.
+         * @remarks The view reads from the stream of this table (or its decrypted copy), so it must not outlive the stream or the table.
+         * @return The view, or nullptr if the field does not exist or is not a data field.
+         */
+        IStream *OpenFieldDataStream(uint32_t rowIndex, uint32_t columnIndex) const;
+
+        /**
+         * Copies a field, with its name and value, to a field object.
+         * @remarks The value of a data field is read from the stream.
+         */
+        void GetField(uint32_t rowIndex, uint32_t columnIndex, CUtfField &field) const;
+
+        bool_t GetFieldOffset(uint32_t rowIndex, const char *fieldName, uint64_t *offset) const;
+
+        bool_t GetFieldSize(uint32_t rowIndex, const char *fieldName, uint32_t *size) const;
+
+        /**
+         * Checks whether the first 4 bytes of a table are the "@UTF" signature, either plain or encrypted.
+         */
+        static bool_t IsUtfSignature(const uint8_t *magic);
 
     protected:
 
         CUtfReader *GetReader() const;
 
-        std::vector<CUtfTable::UtfRow> _rows;
-
         virtual void Initialize();
 
     private:
@@ -64,15 +140,58 @@ CGSS_NS_BEGIN
 
         static void ReadUtfHeader(IStream *stream, uint64_t streamOffset, UTF_HEADER &header, char *tableNameBuffer);
 
-        void InitializeUtfSchema(IStream *sourceStream, CMemoryStream *tableDataStream, uint64_t schemaOffset);
+        void InitializeUtfSchema(uint64_t schemaOffset);
 
         CMemoryStream *GetTableDataStream();
 
+        /**
+         * Gets the raw value of a field in the table data, or nullptr for a zero column.
+         * @remarks The values of data fields are not in the table data; only their offsets and sizes are.
+         * @return FALSE if the row or the column does not exist.
+         */
+        bool_t GetFieldValuePointer(uint32_t rowIndex, uint32_t columnIndex, const uint8_t **data) const;
+
+        /**
+         * Gets the stream the values of data fields are read from, and maps an offset in the stream of the table to it.
+         * @remarks Encrypted tables are decrypted as a whole, so their data fields are read from the decrypted copy.
+         */
+        IStream *GetFieldDataSource(uint64_t &offset) const;
+
+        /**
+         * Gets the offset and size of a field the way UTF_FIELD records them. Only data fields have a size, and their
+         * offset is in the stream; other offsets are in the table data.
+         */
+        bool_t GetFieldLocation(uint32_t rowIndex, uint32_t columnIndex, uint64_t *offset, uint32_t *size) const;
+
+        template<typename T>
+        bool_t GetFieldNumber(uint32_t rowIndex, uint32_t columnIndex, T *value) const;
+
+        typedef struct {
+            // Points into the string table.
+            const char *name;
+            UtfColumnType type;
+            UtfColumnStorage storage;
+            // Offset of the value in a row for per-row columns, or in the table data for constant columns.
+            uint32_t offset;
+        } UtfColumn;
+
+        struct ColumnNameHash {
+            size_t operator()(const char *name) const;
+        };
+
+        struct ColumnNameEqual {
+            bool operator()(const char *left, const char *right) const;
+        };
+
         UTF_HEADER _utfHeader;
         IStream *_stream;
         bool_t _isEncrypted;
         uint64_t _streamOffset;
         CUtfReader *_utfReader;
+        CMemoryStream *_tableDataStream;
+        std::vector<UtfColumn> _columns;
+        // Column names to indices. The keys are the names in the string table.
+        std::unordered_map<const char *, uint32_t, ColumnNameHash, ColumnNameEqual> _columnIndices;
         char _tableName[UTF_TABLE_MAX_NAME_LEN];
 
     };
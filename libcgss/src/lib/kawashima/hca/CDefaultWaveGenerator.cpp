@@ -1,6 +1,14 @@
+#include <algorithm>
 #include "CDefaultWaveGenerator.h"
+#include "../../common/cpu_features.h"
+#include "../../common/quick_utils.h"
 #include "../../takamori/exceptions/CArgumentException.h"
 
+#ifdef _MSC_VER
+#undef max
+#undef min
+#endif
+
 CGSS_NS_BEGIN
 
     uint32_t CDefaultWaveGenerator::Decode8BitU(float data, uint8_t *buffer, const uint32_t cursor) {
@@ -59,4 +67,315 @@ CGSS_NS_BEGIN
         return cursor + 4;
     }
 
+    namespace {
+
+        // Samples are converted in chunks of this many per channel, then interleaved.
+        const uint32_t BlockChunkSize = 128;
+        const uint32_t BlockMaxChannels = 16;
+
+        // Scalar conversions, written exactly like the per-sample functions so both paths agree bit by bit.
+
+        inline float GainClamp(float data, float gain) {
+            return clamp(data * gain, -1.0f, 1.0f);
+        }
+
+        void ConvertFloatScalar(const float *src, float gain, uint32_t count, float *dst) {
+            for (uint32_t i = 0; i < count; ++i) {
+                dst[i] = GainClamp(src[i], gain);
+            }
+        }
+
+        void Convert8BitUScalar(const float *src, float gain, uint32_t count, uint8_t *dst) {
+            for (uint32_t i = 0; i < count; ++i) {
+                dst[i] = (uint8_t)((int32_t)(GainClamp(src[i], gain) * 0x7f) + 0x80);
+            }
+        }
+
+        void Convert16BitSScalar(const float *src, float gain, uint32_t count, int16_t *dst) {
+            for (uint32_t i = 0; i < count; ++i) {
+                dst[i] = (int16_t)(GainClamp(src[i], gain) * 0x7fff);
+            }
+        }
+
+        void Convert24BitSScalar(const float *src, float gain, uint32_t count, int32_t *dst) {
+            for (uint32_t i = 0; i < count; ++i) {
+                dst[i] = (int32_t)(GainClamp(src[i], gain) * 0x7fffff);
+            }
+        }
+
+        void Convert32BitSScalar(const float *src, float gain, uint32_t count, int32_t *dst) {
+            for (uint32_t i = 0; i < count; ++i) {
+                dst[i] = (int32_t)((double)GainClamp(src[i], gain) * 0x7fffffff);
+            }
+        }
+
+#ifdef __CGSS_SIMD_X86__
+
+        // SSE2 conversions. min/max give the same result as clamp() for every non-NaN input and the
+        // conversions truncate like C casts; the 32-bit path scales in double like Decode32BitS().
+
+        CGSS_TARGET_SSE2
+        inline __m128 GainClampSse(const float *src, __m128 gain) {
+            const auto v = _mm_mul_ps(_mm_loadu_ps(src), gain);
+            return _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+        }
+
+        CGSS_TARGET_SSE2
+        void ConvertFloatSse(const float *src, float gain, uint32_t count, float *dst) {
+            const auto g = _mm_set1_ps(gain);
+            uint32_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                _mm_storeu_ps(dst + i, GainClampSse(src + i, g));
+            }
+            ConvertFloatScalar(src + i, gain, count - i, dst + i);
+        }
+
+        CGSS_TARGET_SSE2
+        void Convert8BitUSse(const float *src, float gain, uint32_t count, uint8_t *dst) {
+            const auto g = _mm_set1_ps(gain);
+            const auto scale = _mm_set1_ps((float)0x7f);
+            const auto bias = _mm_set1_epi32(0x80);
+            uint32_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                const auto a = _mm_add_epi32(_mm_cvttps_epi32(_mm_mul_ps(GainClampSse(src + i, g), scale)), bias);
+                const auto b = _mm_add_epi32(_mm_cvttps_epi32(_mm_mul_ps(GainClampSse(src + i + 4, g), scale)), bias);
+                const auto words = _mm_packs_epi32(a, b);
+                _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(words, words));
+            }
+            Convert8BitUScalar(src + i, gain, count - i, dst + i);
+        }
+
+        CGSS_TARGET_SSE2
+        void Convert16BitSSse(const float *src, float gain, uint32_t count, int16_t *dst) {
+            const auto g = _mm_set1_ps(gain);
+            const auto scale = _mm_set1_ps((float)0x7fff);
+            uint32_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                const auto a = _mm_cvttps_epi32(_mm_mul_ps(GainClampSse(src + i, g), scale));
+                const auto b = _mm_cvttps_epi32(_mm_mul_ps(GainClampSse(src + i + 4, g), scale));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(a, b));
+            }
+            Convert16BitSScalar(src + i, gain, count - i, dst + i);
+        }
+
+        CGSS_TARGET_SSE2
+        void Convert24BitSSse(const float *src, float gain, uint32_t count, int32_t *dst) {
+            const auto g = _mm_set1_ps(gain);
+            const auto scale = _mm_set1_ps((float)0x7fffff);
+            uint32_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_cvttps_epi32(_mm_mul_ps(GainClampSse(src + i, g), scale)));
+            }
+            Convert24BitSScalar(src + i, gain, count - i, dst + i);
+        }
+
+        CGSS_TARGET_SSE2
+        void Convert32BitSSse(const float *src, float gain, uint32_t count, int32_t *dst) {
+            const auto g = _mm_set1_ps(gain);
+            const auto scale = _mm_set1_pd((double)0x7fffffff);
+            uint32_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                const auto v = GainClampSse(src + i, g);
+                const auto lo = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtps_pd(v), scale));
+                const auto hi = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)), scale));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_unpacklo_epi64(lo, hi));
+            }
+            Convert32BitSScalar(src + i, gain, count - i, dst + i);
+        }
+
+        CGSS_TARGET_SSE2
+        void Interleave16BitStereoSse(const int16_t *left, const int16_t *right, uint32_t count, int16_t *dst) {
+            uint32_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                const auto l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(left + i));
+                const auto r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(right + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 2), _mm_unpacklo_epi16(l, r));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 2 + 8), _mm_unpackhi_epi16(l, r));
+            }
+            for (; i < count; ++i) {
+                dst[i * 2] = left[i];
+                dst[i * 2 + 1] = right[i];
+            }
+        }
+
+        CGSS_TARGET_SSE2
+        void InterleaveFloatStereoSse(const float *left, const float *right, uint32_t count, float *dst) {
+            uint32_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                const auto l = _mm_loadu_ps(left + i);
+                const auto r = _mm_loadu_ps(right + i);
+                _mm_storeu_ps(dst + i * 2, _mm_unpacklo_ps(l, r));
+                _mm_storeu_ps(dst + i * 2 + 4, _mm_unpackhi_ps(l, r));
+            }
+            for (; i < count; ++i) {
+                dst[i * 2] = left[i];
+                dst[i * 2 + 1] = right[i];
+            }
+        }
+
+        inline bool_t HasSse2() {
+            return GetCpuFeatures().sse2;
+        }
+
+#else
+
+        inline bool_t HasSse2() {
+            return FALSE;
+        }
+
+#endif
+
+        template<typename T>
+        void InterleaveGeneric(T (*planes)[BlockChunkSize], uint32_t channelCount, uint32_t count, uint8_t *buffer) {
+            if (channelCount == 1) {
+                memcpy(buffer, planes[0], count * sizeof(T));
+                return;
+            }
+            auto *dst = buffer;
+            for (uint32_t i = 0; i < count; ++i) {
+                for (uint32_t c = 0; c < channelCount; ++c) {
+                    memcpy(dst, &planes[c][i], sizeof(T));
+                    dst += sizeof(T);
+                }
+            }
+        }
+
+        void Interleave24Bit(int32_t (*planes)[BlockChunkSize], uint32_t channelCount, uint32_t count, uint8_t *buffer) {
+            auto *dst = buffer;
+            for (uint32_t i = 0; i < count; ++i) {
+                for (uint32_t c = 0; c < channelCount; ++c) {
+                    const auto v = static_cast<uint32_t>(planes[c][i]);
+                    dst[0] = static_cast<uint8_t>(v);
+                    dst[1] = static_cast<uint8_t>(v >> 8);
+                    dst[2] = static_cast<uint8_t>(v >> 16);
+                    dst += 3;
+                }
+            }
+        }
+
+        void CheckBlockArguments(const float *const *channels, uint32_t channelCount, uint8_t *buffer, const char *paramName) {
+            if (!channels || !buffer || channelCount > BlockMaxChannels) {
+                throw CArgumentException(paramName);
+            }
+        }
+
+    }
+
+    void CDefaultWaveGenerator::Decode8BitUBlock(const float *const *channels, uint32_t channelCount, uint32_t sampleCount, float gain, uint8_t *buffer) {
+        CheckBlockArguments(channels, channelCount, buffer, "CDefaultWaveGenerator::Decode8BitUBlock");
+#ifdef __CGSS_SIMD_X86__
+        const auto convert = HasSse2() ? Convert8BitUSse : Convert8BitUScalar;
+#else
+        const auto convert = Convert8BitUScalar;
+#endif
+        uint8_t planes[BlockMaxChannels][BlockChunkSize];
+        for (uint32_t start = 0; start < sampleCount; start += BlockChunkSize) {
+            const auto count = std::min(BlockChunkSize, sampleCount - start);
+            for (uint32_t c = 0; c < channelCount; ++c) {
+                convert(channels[c] + start, gain, count, planes[c]);
+            }
+            InterleaveGeneric(planes, channelCount, count, buffer + start * channelCount);
+        }
+    }
+
+    void CDefaultWaveGenerator::Decode16BitSBlock(const float *const *channels, uint32_t channelCount, uint32_t sampleCount, float gain, uint8_t *buffer) {
+        CheckBlockArguments(channels, channelCount, buffer, "CDefaultWaveGenerator::Decode16BitSBlock");
+        const auto sse2 = HasSse2();
+#ifdef __CGSS_SIMD_X86__
+        const auto convert = sse2 ? Convert16BitSSse : Convert16BitSScalar;
+#else
+        const auto convert = Convert16BitSScalar;
+#endif
+        int16_t planes[BlockMaxChannels][BlockChunkSize];
+        for (uint32_t start = 0; start < sampleCount; start += BlockChunkSize) {
+            const auto count = std::min(BlockChunkSize, sampleCount - start);
+            for (uint32_t c = 0; c < channelCount; ++c) {
+                convert(channels[c] + start, gain, count, planes[c]);
+            }
+            auto *dst = buffer + start * channelCount * sizeof(int16_t);
+#ifdef __CGSS_SIMD_X86__
+            if (sse2 && channelCount == 2) {
+                Interleave16BitStereoSse(planes[0], planes[1], count, reinterpret_cast<int16_t *>(dst));
+                continue;
+            }
+#endif
+            InterleaveGeneric(planes, channelCount, count, dst);
+        }
+    }
+
+    void CDefaultWaveGenerator::Decode24BitSBlock(const float *const *channels, uint32_t channelCount, uint32_t sampleCount, float gain, uint8_t *buffer) {
+        CheckBlockArguments(channels, channelCount, buffer, "CDefaultWaveGenerator::Decode24BitSBlock");
+#ifdef __CGSS_SIMD_X86__
+        const auto convert = HasSse2() ? Convert24BitSSse : Convert24BitSScalar;
+#else
+        const auto convert = Convert24BitSScalar;
+#endif
+        int32_t planes[BlockMaxChannels][BlockChunkSize];
+        for (uint32_t start = 0; start < sampleCount; start += BlockChunkSize) {
+            const auto count = std::min(BlockChunkSize, sampleCount - start);
+            for (uint32_t c = 0; c < channelCount; ++c) {
+                convert(channels[c] + start, gain, count, planes[c]);
+            }
+            Interleave24Bit(planes, channelCount, count, buffer + start * channelCount * 3);
+        }
+    }
+
+    void CDefaultWaveGenerator::Decode32BitSBlock(const float *const *channels, uint32_t channelCount, uint32_t sampleCount, float gain, uint8_t *buffer) {
+        CheckBlockArguments(channels, channelCount, buffer, "CDefaultWaveGenerator::Decode32BitSBlock");
+#ifdef __CGSS_SIMD_X86__
+        const auto convert = HasSse2() ? Convert32BitSSse : Convert32BitSScalar;
+#else
+        const auto convert = Convert32BitSScalar;
+#endif
+        int32_t planes[BlockMaxChannels][BlockChunkSize];
+        for (uint32_t start = 0; start < sampleCount; start += BlockChunkSize) {
+            const auto count = std::min(BlockChunkSize, sampleCount - start);
+            for (uint32_t c = 0; c < channelCount; ++c) {
+                convert(channels[c] + start, gain, count, planes[c]);
+            }
+            InterleaveGeneric(planes, channelCount, count, buffer + start * channelCount * sizeof(int32_t));
+        }
+    }
+
+    void CDefaultWaveGenerator::DecodeFloatBlock(const float *const *channels, uint32_t channelCount, uint32_t sampleCount, float gain, uint8_t *buffer) {
+        CheckBlockArguments(channels, channelCount, buffer, "CDefaultWaveGenerator::DecodeFloatBlock");
+        const auto sse2 = HasSse2();
+#ifdef __CGSS_SIMD_X86__
+        const auto convert = sse2 ? ConvertFloatSse : ConvertFloatScalar;
+#else
+        const auto convert = ConvertFloatScalar;
+#endif
+        float planes[BlockMaxChannels][BlockChunkSize];
+        for (uint32_t start = 0; start < sampleCount; start += BlockChunkSize) {
+            const auto count = std::min(BlockChunkSize, sampleCount - start);
+            for (uint32_t c = 0; c < channelCount; ++c) {
+                convert(channels[c] + start, gain, count, planes[c]);
+            }
+            auto *dst = buffer + start * channelCount * sizeof(float);
+#ifdef __CGSS_SIMD_X86__
+            if (sse2 && channelCount == 2) {
+                InterleaveFloatStereoSse(planes[0], planes[1], count, reinterpret_cast<float *>(dst));
+                continue;
+            }
+#endif
+            InterleaveGeneric(planes, channelCount, count, dst);
+        }
+    }
+
+    CDefaultWaveGenerator::BlockDecodeFunc CDefaultWaveGenerator::GetBlockDecodeFunc(uint32_t (*decodeFunc)(float, uint8_t *, uint32_t)) {
+        if (decodeFunc == Decode8BitU) {
+            return Decode8BitUBlock;
+        } else if (decodeFunc == Decode16BitS) {
+            return Decode16BitSBlock;
+        } else if (decodeFunc == Decode24BitS) {
+            return Decode24BitSBlock;
+        } else if (decodeFunc == Decode32BitS) {
+            return Decode32BitSBlock;
+        } else if (decodeFunc == DecodeFloat) {
+            return DecodeFloatBlock;
+        } else {
+            return nullptr;
+        }
+    }
+
 CGSS_NS_END
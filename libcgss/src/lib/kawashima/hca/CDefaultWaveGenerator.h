@@ -18,6 +18,33 @@ CGSS_NS_BEGIN
 
         static uint32_t DecodeFloat(float data, uint8_t *buffer, uint32_t cursor);
 
+        /**
+         * Converts planar samples to interleaved output, applying the gain and clamping to [-1, 1] like the per-sample functions.
+         * @param channels Sample planes, one per channel, each holding sampleCount samples.
+         * @param channelCount Number of planes.
+         * @param sampleCount Number of samples per channel.
+         * @param gain Gain applied before clamping.
+         * @param buffer Output buffer, at least sampleCount * channelCount * (bytes per sample) long.
+         */
+        typedef void (*BlockDecodeFunc)(const float *const *channels, uint32_t channelCount, uint32_t sampleCount, float gain, uint8_t *buffer);
+
+        static void Decode8BitUBlock(const float *const *channels, uint32_t channelCount, uint32_t sampleCount, float gain, uint8_t *buffer);
+
+        static void Decode16BitSBlock(const float *const *channels, uint32_t channelCount, uint32_t sampleCount, float gain, uint8_t *buffer);
+
+        static void Decode24BitSBlock(const float *const *channels, uint32_t channelCount, uint32_t sampleCount, float gain, uint8_t *buffer);
+
+        static void Decode32BitSBlock(const float *const *channels, uint32_t channelCount, uint32_t sampleCount, float gain, uint8_t *buffer);
+
+        static void DecodeFloatBlock(const float *const *channels, uint32_t channelCount, uint32_t sampleCount, float gain, uint8_t *buffer);
+
+        /**
+         * Finds the block converter producing the same output as a per-sample function.
+         * @param decodeFunc One of the per-sample functions above, or a custom one.
+         * @return The matching block converter, or nullptr for custom functions.
+         */
+        static BlockDecodeFunc GetBlockDecodeFunc(uint32_t (*decodeFunc)(float, uint8_t *, uint32_t));
+
     PURE_STATIC(CDefaultWaveGenerator);
 
     };
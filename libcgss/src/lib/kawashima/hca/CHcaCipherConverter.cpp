@@ -148,15 +148,13 @@ CGSS_NS_BEGIN
         blockBuffers[blockIndex] = blockBuffer;
         ENSURE_READ_ALL_BUFFER(blockBuffer, hcaInfo.blockSize);
 
-        if (ComputeChecksum(blockBuffer, hcaInfo.blockSize, 0) != 0) {
+        // Verify and decipher. The checksum bytes are deciphered as well, but they are rewritten below.
+        if (!cipherFrom->VerifyAndDecrypt(blockBuffer, hcaInfo.blockSize)) {
             char numberBuffer[20] = {0};
             sprintf(numberBuffer, "%u", blockIndex);
             throw CFormatException(std::string("CHcaCipherConverter::ConvertBlock @ Block#") + numberBuffer);
         }
-
-        // Decipher.
         const auto validDataSize = static_cast<uint32_t>(hcaInfo.blockSize - 2);
-        cipherFrom->Decrypt(blockBuffer, validDataSize);
 
         // Check magic piece of plain text.
         CHcaData data(blockBuffer, hcaInfo.blockSize, hcaInfo.blockSize);
@@ -1,14 +1,17 @@
 #include <algorithm>
+#include <mutex>
 #include "CHcaDecoder.h"
+#include "CDefaultWaveGenerator.h"
 #include "internal/CHcaAth.h"
+#include "internal/CHcaBlockCache.h"
 #include "internal/CHcaChannel.h"
 #include "internal/CHcaCipher.h"
-#include "internal/CHcaData.h"
 #include "../../common/quick_utils.h"
 #include "hca_utils.h"
 #include "../../takamori/exceptions/CArgumentException.h"
 #include "../wave/wave_native.h"
 #include "../../takamori/streams/CMemoryStream.h"
+#include "../../takamori/CParallel.h"
 
 #ifdef _MSC_VER
 #undef max
@@ -28,18 +31,25 @@ CGSS_NS_BEGIN
         for (auto i = 0; i < ChannelCount; ++i) {
             _channels[i] = nullptr;
         }
-        _waveHeaderBuffer = _hcaBlockBuffer = nullptr;
+        _waveHeaderBuffer = _hcaBlockBuffer = _waveBlockBuffer = nullptr;
+        _blockCache = nullptr;
         _waveHeaderSize = _waveBlockSize = 0;
         _position = 0;
+        _channels_vgmstream = nullptr;
+        _random = 0;
+        _nextBlockIndex = 0;
+        _hasCarriedBlockState = FALSE;
+        _blockEntryStateCount = 0;
         clone(decoderConfig, _decoderConfig);
+        InitializeWaveFormat();
         InitializeExtra();
     }
 
     CHcaDecoder::~CHcaDecoder() {
-        for (const auto &v : _decodedBlocks) {
-            delete[] v.second;
+        if (_blockCache) {
+            delete _blockCache;
+            _blockCache = nullptr;
         }
-        _decodedBlocks.clear();
         if (_waveHeaderBuffer) {
             delete[] _waveHeaderBuffer;
             _waveHeaderBuffer = nullptr;
@@ -48,6 +58,10 @@ CGSS_NS_BEGIN
             delete[] _hcaBlockBuffer;
             _hcaBlockBuffer = nullptr;
         }
+        if (_waveBlockBuffer) {
+            delete[] _waveBlockBuffer;
+            _waveBlockBuffer = nullptr;
+        }
         if (_ath) {
             delete _ath;
             _ath = nullptr;
@@ -63,7 +77,8 @@ CGSS_NS_BEGIN
             }
         }
         if (_channels_vgmstream) {
-            delete _channels_vgmstream;
+            delete[] _channels_vgmstream;
+            _channels_vgmstream = nullptr;
         }
     }
 
@@ -128,20 +143,80 @@ CGSS_NS_BEGIN
             }
         }
         auto *channels = _channels;
-        stChannel* channels_vgmstream = new stChannel[hcaInfo.channelCount];
         for (auto i = 0; i < hcaInfo.channelCount; ++i) {
             channels[i] = new CHcaChannel();
             channels[i]->type = r[i];
             channels[i]->value3 = &channels[i]->value[hcaInfo.compR06 + hcaInfo.compR07];
             channels[i]->count = hcaInfo.compR06 + ((r[i] != 2) ? hcaInfo.compR07 : 0);
+        }
+        _channels_vgmstream = new stChannel[hcaInfo.channelCount];
+        ResetChannelStates(_channels_vgmstream);
+        _random = hcaInfo.random;
+        _hasCarriedBlockState = HasCarriedBlockState();
 
-            memset(&channels_vgmstream[i], 0, sizeof(stChannel));
-            channels_vgmstream[i].type = (channel_type_t)channels[i]->type;
-            channels_vgmstream[i].coded_count = (channels[i]->type != STEREO_SECONDARY) ?
-                hcaInfo.compR06 + hcaInfo.compR07 :
-                hcaInfo.compR06;
+        _blockCache = new CHcaBlockCache(hcaInfo.blockCount, GetWaveBlockSize(), _decoderConfig.blockCacheSize);
+    }
+
+    void CHcaDecoder::InitializeWaveFormat() {
+        // HCA_DECODER_CONFIG is packed, so work on a copy rather than a reference to the (possibly misaligned) member.
+        auto decodeFunc = _decoderConfig.decodeFunc;
+        auto format = static_cast<HcaWaveFormat>(_decoderConfig.waveFormat);
+
+        if (format == HcaWaveFormat::Default) {
+            if (decodeFunc == CDefaultWaveGenerator::Decode8BitU) {
+                format = HcaWaveFormat::PcmU8;
+            } else if (decodeFunc == CDefaultWaveGenerator::Decode24BitS) {
+                format = HcaWaveFormat::PcmS24;
+            } else if (decodeFunc == CDefaultWaveGenerator::Decode32BitS) {
+                format = HcaWaveFormat::PcmS32;
+            } else if (decodeFunc == CDefaultWaveGenerator::DecodeFloat) {
+                format = HcaWaveFormat::Float;
+            } else {
+                format = HcaWaveFormat::PcmS16;
+            }
+        }
+
+        if (!decodeFunc) {
+            switch (format) {
+                case HcaWaveFormat::PcmU8:
+                    decodeFunc = CDefaultWaveGenerator::Decode8BitU;
+                    break;
+                case HcaWaveFormat::PcmS16:
+                    decodeFunc = CDefaultWaveGenerator::Decode16BitS;
+                    break;
+                case HcaWaveFormat::PcmS24:
+                    decodeFunc = CDefaultWaveGenerator::Decode24BitS;
+                    break;
+                case HcaWaveFormat::PcmS32:
+                    decodeFunc = CDefaultWaveGenerator::Decode32BitS;
+                    break;
+                case HcaWaveFormat::Float:
+                    decodeFunc = CDefaultWaveGenerator::DecodeFloat;
+                    break;
+                default:
+                    throw CArgumentException("CHcaDecoder::InitializeWaveFormat");
+            }
+            _decoderConfig.decodeFunc = decodeFunc;
+        }
+
+        _waveFormat = format;
+    }
+
+    HcaWaveFormat CHcaDecoder::GetWaveFormat() const {
+        return _waveFormat;
+    }
+
+    uint32_t CHcaDecoder::GetWaveBytesPerSample() const {
+        switch (_waveFormat) {
+            case HcaWaveFormat::PcmU8:
+                return 1;
+            case HcaWaveFormat::PcmS16:
+                return 2;
+            case HcaWaveFormat::PcmS24:
+                return 3;
+            default:
+                return 4;
         }
-        _channels_vgmstream = channels_vgmstream;
     }
 
     uint32_t CHcaDecoder::GetWaveHeaderSize() {
@@ -151,7 +226,7 @@ CGSS_NS_BEGIN
 
         auto &hcaInfo = _hcaInfo;
         uint32_t sizeNeeded = sizeof(WaveRiffSection);
-        if (hcaInfo.loopExists && !WaveSettings::SoftLoop) {
+        if (hcaInfo.loopExists) {
             sizeNeeded += sizeof(WaveSampleSection);
         }
         if (hcaInfo.commentLength > 0) {
@@ -181,9 +256,10 @@ CGSS_NS_BEGIN
         WaveNoteSection wavNote = {'n', 'o', 't', 'e', 0, 0};
         WaveDataSection wavData = {'d', 'a', 't', 'a', 0};
 
-        wavRiff.fmtType = static_cast<uint16_t>((WaveSettings::BitPerChannel > 0) ? 1 : 3);
+        // WAVE_FORMAT_PCM or WAVE_FORMAT_IEEE_FLOAT
+        wavRiff.fmtType = static_cast<uint16_t>(_waveFormat == HcaWaveFormat::Float ? 3 : 1);
         wavRiff.fmtChannelCount = static_cast<uint16_t>(hcaInfo.channelCount);
-        wavRiff.fmtBitCount = static_cast<uint16_t>((WaveSettings::BitPerChannel > 0) ? WaveSettings::BitPerChannel : 32);
+        wavRiff.fmtBitCount = static_cast<uint16_t>(GetWaveBytesPerSample() * 8);
         wavRiff.fmtSamplingRate = hcaInfo.samplingRate;
         wavRiff.fmtSamplingSize = static_cast<uint16_t>(wavRiff.fmtBitCount / 8 * wavRiff.fmtChannelCount);
         wavRiff.fmtSamplesPerSec = wavRiff.fmtSamplingRate * wavRiff.fmtSamplingSize;
@@ -192,9 +268,6 @@ CGSS_NS_BEGIN
             wavSmpl.loopStart = hcaInfo.loopStart * 0x80 * 8 + hcaInfo.fmtR02; // fmtR02 is muteFooter
             wavSmpl.loopEnd = hcaInfo.loopEnd * 0x80 * 8;
             wavSmpl.loopPlayCount = (hcaInfo.loopR01 == 0x80) ? 0 : hcaInfo.loopR01;
-        } else if (WaveSettings::SoftLoop) {
-            wavSmpl.loopStart = 0;
-            wavSmpl.loopEnd = hcaInfo.blockCount * 0x80 * 8;
         }
         if (hcaInfo.commentLength > 0) {
             wavNote.noteSize = 4 + hcaInfo.commentLength + 1;
@@ -202,16 +275,15 @@ CGSS_NS_BEGIN
                 wavNote.noteSize += 4 - (wavNote.noteSize & 3);
             }
         }
-        wavData.dataSize = wavRiff.fmtSamplingSize * (hcaInfo.blockCount * 0x80 * 8 +
-                                                      (wavSmpl.loopEnd - wavSmpl.loopStart) * _decoderConfig.loopCount);
-        wavRiff.riffSize = static_cast<uint32_t>(0x1C + ((hcaInfo.loopExists && !WaveSettings::SoftLoop) ? sizeof(wavSmpl) : 0) +
+        wavData.dataSize = static_cast<uint32_t>(wavRiff.fmtSamplingSize * GetSampleCount());
+        wavRiff.riffSize = static_cast<uint32_t>(0x1C + ((hcaInfo.loopExists) ? sizeof(wavSmpl) : 0) +
                                                  (hcaInfo.commentLength > 0 ? 8 + wavNote.noteSize : 0) + sizeof(wavData) +
                                                  wavData.dataSize);
 
         CMemoryStream memoryStream(headerBuffer, headerSize);
 #define WRITE_STRUCT(var) memoryStream.Write(&var, sizeof(var), 0, sizeof(var))
         WRITE_STRUCT(wavRiff);
-        if (hcaInfo.loopExists && !WaveSettings::SoftLoop) {
+        if (hcaInfo.loopExists) {
             WRITE_STRUCT(wavSmpl);
         }
         if (hcaInfo.commentLength > 0) {
@@ -228,49 +300,154 @@ CGSS_NS_BEGIN
         if (_waveBlockSize) {
             return _waveBlockSize;
         }
-        uint32_t audioBitPerChannel = WaveSettings::BitPerChannel != 0 ? WaveSettings::BitPerChannel : sizeof(float);
-        uint32_t waveBlockSize = 0x80 * (audioBitPerChannel / sizeof(uint8_t)) * _hcaInfo.channelCount;
+        uint32_t waveBlockSize = HCA_SUBFRAMES * HCA_SAMPLES_PER_SUBFRAME * GetWaveBytesPerSample() * _hcaInfo.channelCount;
         _waveBlockSize = waveBlockSize;
         return waveBlockSize;
     }
 
     const uint8_t *CHcaDecoder::DecodeBlock(uint32_t blockIndex) {
-        auto &decodedBlocks = _decodedBlocks;
         {
-            const auto decodedItem = decodedBlocks.find(blockIndex);
-            if (decodedItem != decodedBlocks.cend()) {
-                return decodedItem->second;
+            const auto cachedBlock = _blockCache->Find(blockIndex);
+            if (cachedBlock) {
+                return cachedBlock;
             }
         }
 
-        auto stream = _baseStream;
+        const auto waveBlockBuffer = _blockCache->Allocate(blockIndex);
+        try {
+            DecodeBlock(blockIndex, waveBlockBuffer);
+        } catch (...) {
+            _blockCache->Remove(blockIndex);
+            throw;
+        }
+
+        return waveBlockBuffer;
+    }
+
+    void CHcaDecoder::DecodeBlock(uint32_t blockIndex, uint8_t *waveBlockBuffer) {
         const auto &hcaInfo = _hcaInfo;
-        const auto waveBlockSize = GetWaveBlockSize();
-        const auto *channels = _channels;
+        const auto intensityStride = hcaInfo.channelCount * HCA_SUBFRAMES;
 
         auto hcaBlockBuffer = _hcaBlockBuffer ? _hcaBlockBuffer : new uint8_t[hcaInfo.blockSize];
         _hcaBlockBuffer = hcaBlockBuffer;
 
+        // Decoding continues from the previous block, unless we are jumping around (seeking, looping, or re-decoding
+        // an evicted block).
+        if (blockIndex != _nextBlockIndex) {
+            PreRollBlock(blockIndex);
+        }
+        auto channels = _channels_vgmstream;
+
+        // Record what this block starts with, so that we can come back later without scanning the whole stream.
+        if (_hasCarriedBlockState && blockIndex == _blockEntryStateCount) {
+            _blockEntryRandoms.resize(hcaInfo.blockCount);
+            _blockEntryIntensities.resize(hcaInfo.blockCount * intensityStride);
+            _blockEntryRandoms[blockIndex] = _random;
+            for (uint32_t ch = 0; ch < hcaInfo.channelCount; ++ch) {
+                memcpy(&_blockEntryIntensities[blockIndex * intensityStride + ch * HCA_SUBFRAMES], channels[ch].intensity, HCA_SUBFRAMES);
+            }
+            ++_blockEntryStateCount;
+        }
+
+        _nextBlockIndex = InvalidBlockIndex;
+        ReadBlock(blockIndex, hcaBlockBuffer);
+        DecodeBlockData(hcaBlockBuffer, channels, &_random);
+        _nextBlockIndex = blockIndex + 1;
+
+        // Generate wave data.
+        GenerateWaveData(channels, waveBlockBuffer);
+    }
+
+    void CHcaDecoder::ReadBlock(uint32_t blockIndex, uint8_t *hcaBlockBuffer) {
+        auto stream = _baseStream;
+        const auto &hcaInfo = _hcaInfo;
+
         stream->Seek(hcaInfo.dataOffset + hcaInfo.blockSize * blockIndex, StreamSeekOrigin::Begin);
         auto actualRead = stream->Read(hcaBlockBuffer, hcaInfo.blockSize, 0, hcaInfo.blockSize);
         if (actualRead < hcaInfo.blockSize) {
             throw CException(CGSS_OP_DECODE_FAILED);
         }
 
-        // Compute block checksum.
-        if (ComputeChecksum(hcaBlockBuffer, hcaInfo.blockSize, 0) != 0) {
+        VerifyBlocks(hcaBlockBuffer, 1);
+    }
+
+    void CHcaDecoder::PreRollBlock(uint32_t blockIndex) {
+        const auto &hcaInfo = _hcaInfo;
+        auto channels = _channels_vgmstream;
+
+        _nextBlockIndex = InvalidBlockIndex;
+        ResetChannelStates(channels);
+        if (blockIndex == 0) {
+            _random = hcaInfo.random;
+            _nextBlockIndex = 0;
+            return;
+        }
+
+        const auto previousBlockIndex = blockIndex - 1;
+        if (_hasCarriedBlockState && previousBlockIndex >= _blockEntryStateCount) {
+            BuildBlockEntryStates(0);
+        }
+        RestoreBlockEntryState(previousBlockIndex, channels, &_random);
+        ReadBlock(previousBlockIndex, _hcaBlockBuffer);
+        DecodeBlockData(_hcaBlockBuffer, channels, &_random);
+        _nextBlockIndex = blockIndex;
+    }
+
+    void CHcaDecoder::ResetChannelStates(stChannel *channels) {
+        const auto &hcaInfo = _hcaInfo;
+        for (uint32_t i = 0; i < hcaInfo.channelCount; ++i) {
+            memset(&channels[i], 0, sizeof(stChannel));
+            channels[i].type = (channel_type_t)_channels[i]->type;
+            channels[i].coded_count = (_channels[i]->type != STEREO_SECONDARY) ?
+                hcaInfo.compR06 + hcaInfo.compR07 :
+                hcaInfo.compR06;
+        }
+    }
+
+    void CHcaDecoder::VerifyBlocks(uint8_t *hcaBlockBuffer, uint32_t blockCount) {
+        const auto &hcaInfo = _hcaInfo;
+        const auto blockSize = hcaInfo.blockSize;
+
+        // Checksums are computed while the blocks are decrypted.
+        if (_cipher->VerifyAndDecryptBlocks(hcaBlockBuffer, blockSize, blockCount) < blockCount) {
             throw CException(CGSS_OP_CHECKSUM_ERROR);
         }
 
-        // Decrypt block if needed.
-        _cipher->Decrypt(hcaBlockBuffer, hcaInfo.blockSize);
+        for (uint32_t i = 0; i < blockCount; ++i) {
+            const auto *block = hcaBlockBuffer + static_cast<size_t>(i) * blockSize;
+            const auto magic = (block[0] << 8) | block[1];
+            if (magic != 0xffff) {
+                throw CException(CGSS_OP_DECODE_FAILED);
+            }
+        }
+    }
+
+    void CHcaDecoder::UnpackBlockHeader(clData *br, stChannel *channels) {
+        const auto &hcaInfo = _hcaInfo;
+        unsigned int hcaInfoVersion = hcaInfo.versionMajor * 0x100 + hcaInfo.versionMinor;
+        unsigned int ch;
 
-        CHcaData data(hcaBlockBuffer, hcaInfo.blockSize, hcaInfo.blockSize);
+        /* lib saves this in the struct since they can stop/resume subframe decoding */
+        unsigned int frame_acceptable_noise_level = bitreader_read(br, 9);
+        unsigned int frame_evaluation_boundary = bitreader_read(br, 7);
 
-        const auto magic = data.GetBit(16);
-        if (magic != 0xffff) {
-            throw CException(CGSS_OP_DECODE_FAILED);
+        unsigned int packed_noise_level = (frame_acceptable_noise_level << 8) - frame_evaluation_boundary;
+
+        for (ch = 0; ch < hcaInfo.channelCount; ch++) {
+            int err = unpack_scalefactors(&channels[ch], br, hcaInfo.compR09, hcaInfoVersion);
+            if (err < 0)
+                throw CException(CGSS_OP_DECODE_FAILED);
+
+            unpack_intensity(&channels[ch], br, hcaInfo.compR09, hcaInfoVersion);
+
+            calculate_resolution(&channels[ch], packed_noise_level, _ath->GetTable(), hcaInfo.compR01, hcaInfo.compR02);
+
+            calculate_gain(&channels[ch]);
         }
+    }
+
+    void CHcaDecoder::DecodeBlockData(const uint8_t *hcaBlockBuffer, stChannel *channels, uint32_t *random) {
+        const auto &hcaInfo = _hcaInfo;
 
         // Actual decoding process.
         /*
@@ -297,39 +474,19 @@ CGSS_NS_BEGIN
         
         //clHCA_DecodeBlock_unpack
         clData br;
-        unsigned short sync;
         unsigned int subframe, ch;
         bitreader_init(&br, hcaBlockBuffer, hcaInfo.blockSize);
         bitreader_read(&br, 16);
         unsigned int hcaInfoVersion = hcaInfo.versionMajor * 0x100 + hcaInfo.versionMinor;
-        stChannel* channels_vgmstream = _channels_vgmstream;
         /* unpack frame values */
-        {
-            /* lib saves this in the struct since they can stop/resume subframe decoding */
-            unsigned int frame_acceptable_noise_level = bitreader_read(&br, 9);
-            unsigned int frame_evaluation_boundary = bitreader_read(&br, 7);
-
-            unsigned int packed_noise_level = (frame_acceptable_noise_level << 8) - frame_evaluation_boundary;
-
-            for (ch = 0; ch < hcaInfo.channelCount; ch++) {
-                int err = unpack_scalefactors(&channels_vgmstream[ch], &br, hcaInfo.compR09, hcaInfoVersion);
-                if (err < 0)
-                    throw CException(CGSS_OP_DECODE_FAILED);
-
-                unpack_intensity(&channels_vgmstream[ch], &br, hcaInfo.compR09, hcaInfoVersion);
-
-                calculate_resolution(&channels_vgmstream[ch], packed_noise_level, _ath->GetTable(), hcaInfo.compR01, hcaInfo.compR02);
-
-                calculate_gain(&channels_vgmstream[ch]);
-            }
-        }
+        UnpackBlockHeader(&br, channels);
 
         /* lib seems to use a state value to skip parts (unpacking/subframe N/etc) as needed */
         for (subframe = 0; subframe < 8; subframe++) {
 
             /* unpack channel data and get dequantized spectra */
             for (ch = 0; ch < hcaInfo.channelCount; ch++) {
-                dequantize_coefficients(&channels_vgmstream[ch], &br, subframe);
+                dequantize_coefficients(&channels[ch], &br, subframe);
             }
 
             /* original code transforms subframe here, but we have it for later */
@@ -340,47 +497,269 @@ CGSS_NS_BEGIN
             for (subframe = 0; subframe < 8; subframe++) {
                 /* restore missing bands from spectra */
                 for (ch = 0; ch < hcaInfo.channelCount; ch++) {
-                    reconstruct_noise(&channels_vgmstream[ch], hcaInfo.compR01, /*hcaInfo.ms_stereo*/0, (unsigned int*)&hcaInfo.random, subframe);
+                    reconstruct_noise(&channels[ch], hcaInfo.compR01, /*hcaInfo.ms_stereo*/0, random, subframe);
 
-                    reconstruct_high_frequency(&channels_vgmstream[ch], hcaInfo.compR09, hcaInfo.compR08,
+                    reconstruct_high_frequency(&channels[ch], hcaInfo.compR09, hcaInfo.compR08,
                         hcaInfo.compR07, hcaInfo.compR06, hcaInfo.compR05, hcaInfoVersion, subframe);
                 }
 
                 /* restore missing joint stereo bands */
                 if (hcaInfo.compR07 > 0) {
                     for (ch = 0; ch < hcaInfo.channelCount - 1; ch++) {
-                        apply_intensity_stereo(&channels_vgmstream[ch], subframe, hcaInfo.compR06, hcaInfo.compR05);
+                        apply_intensity_stereo(&channels[ch], subframe, hcaInfo.compR06, hcaInfo.compR05);
 
-                        apply_ms_stereo(&channels_vgmstream[ch], /*hcaInfo.ms_stereo*/0, hcaInfo.compR06, hcaInfo.compR05, subframe);
+                        apply_ms_stereo(&channels[ch], /*hcaInfo.ms_stereo*/0, hcaInfo.compR06, hcaInfo.compR05, subframe);
                     }
                 }
 
                 /* apply imdct */
                 for (ch = 0; ch < hcaInfo.channelCount; ch++) {
-                    imdct_transform(&channels_vgmstream[ch], subframe);
+                    imdct_transform(&channels[ch], subframe);
                 }
             }
         }
+    }
 
-
-        // Generate wave data.
-        const auto waveBlockBuffer = new uint8_t[waveBlockSize];
+    void CHcaDecoder::GenerateWaveData(const stChannel *channels, uint8_t *waveBlockBuffer) {
+        const auto &hcaInfo = _hcaInfo;
         const auto decodeFunc = _decoderConfig.decodeFunc;
+        const auto blockDecodeFunc = CDefaultWaveGenerator::GetBlockDecodeFunc(decodeFunc);
+        if (blockDecodeFunc) {
+            const float *planes[ChannelCount];
+            for (uint32_t k = 0; k < hcaInfo.channelCount; ++k) {
+                planes[k] = &channels[k].wave[0][0];
+            }
+            blockDecodeFunc(planes, hcaInfo.channelCount, HCA_SUBFRAMES * HCA_SAMPLES_PER_SUBFRAME, hcaInfo.rvaVolume, waveBlockBuffer);
+            return;
+        }
+        // Custom functions are called per sample.
         uint32_t cursor = 0;
         if (decodeFunc) {
             for (auto i = 0; i < 8; ++i) {
                 for (auto j = 0; j < 0x80; ++j) {
                     for (auto k = 0; k < hcaInfo.channelCount; ++k) {
-                        auto f = channels_vgmstream[k].wave[i][j] * hcaInfo.rvaVolume;
+                        auto f = channels[k].wave[i][j] * hcaInfo.rvaVolume;
                         f = clamp(f, -1.0f, 1.0f);
                         cursor = decodeFunc(f, waveBlockBuffer, cursor);
                     }
                 }
             }
         }
+    }
+
+    bool_t CHcaDecoder::HasCarriedBlockState() {
+        const auto &hcaInfo = _hcaInfo;
+        // The noise generator only runs when there is no minimum resolution (before v3.0).
+        if (hcaInfo.compR01 == 0) {
+            return TRUE;
+        }
+        // Before v3.0, an intensity of 15 keeps the intensities of the previous block.
+        const unsigned int hcaInfoVersion = hcaInfo.versionMajor * 0x100 + hcaInfo.versionMinor;
+        if (hcaInfoVersion <= 0x200) {
+            for (uint32_t i = 0; i < hcaInfo.channelCount; ++i) {
+                if (_channels[i]->type == STEREO_SECONDARY) {
+                    return TRUE;
+                }
+            }
+        }
+        return FALSE;
+    }
+
+    void CHcaDecoder::BuildBlockEntryStates(uint32_t threadCount) {
+        if (_blockEntryStateCount >= _hcaInfo.blockCount) {
+            return;
+        }
 
-        decodedBlocks[blockIndex] = waveBlockBuffer;
-        return waveBlockBuffer;
+        const auto &hcaInfo = _hcaInfo;
+        const auto blockCount = hcaInfo.blockCount;
+        const auto blockSize = hcaInfo.blockSize;
+        const auto channelCount = hcaInfo.channelCount;
+        const unsigned int hcaInfoVersion = hcaInfo.versionMajor * 0x100 + hcaInfo.versionMinor;
+        const auto intensityStride = channelCount * HCA_SUBFRAMES;
+
+        // Everything recorded here only depends on the block itself, so blocks can be scanned in any order.
+        std::vector<uint32_t> noiseSteps(blockCount);
+        std::vector<uint8_t> intensities(blockCount * intensityStride);
+        std::vector<uint8_t> intensityKept(blockCount * channelCount);
+        std::mutex streamMutex;
+        const uint32_t chunkBlockCount = ParallelChunkBlockCount;
+        const auto chunkCount = (blockCount + chunkBlockCount - 1) / chunkBlockCount;
+
+        CParallel::For(chunkCount, threadCount, [&](uint32_t chunk) {
+            const auto first = chunk * chunkBlockCount;
+            const auto count = std::min(chunkBlockCount, blockCount - first);
+            std::vector<uint8_t> hcaBlocks(count * blockSize);
+            std::vector<stChannel> channels(channelCount);
+            {
+                std::lock_guard<std::mutex> lock(streamMutex);
+                _baseStream->Seek(hcaInfo.dataOffset + blockSize * first, StreamSeekOrigin::Begin);
+                const auto actualRead = _baseStream->Read(hcaBlocks.data(), count * blockSize, 0, count * blockSize);
+                if (actualRead < count * blockSize) {
+                    throw CException(CGSS_OP_DECODE_FAILED);
+                }
+            }
+            VerifyBlocks(hcaBlocks.data(), count);
+            ResetChannelStates(channels.data());
+            for (uint32_t i = 0; i < count; ++i) {
+                const auto blockIndex = first + i;
+                auto hcaBlockBuffer = hcaBlocks.data() + i * blockSize;
+
+                clData br;
+                bitreader_init(&br, hcaBlockBuffer, blockSize);
+                bitreader_read(&br, 16);
+                UnpackBlockHeader(&br, channels.data());
+
+                uint32_t steps = 0;
+                for (uint32_t ch = 0; ch < channelCount; ++ch) {
+                    const auto &c = channels[ch];
+                    // Mirrors the early returns in reconstruct_noise().
+                    if (hcaInfo.compR01 == 0 && c.valid_count > 0 && c.noise_count > 0) {
+                        steps += c.noise_count * HCA_SUBFRAMES;
+                    }
+                    memcpy(&intensities[blockIndex * intensityStride + ch * HCA_SUBFRAMES], c.intensity, HCA_SUBFRAMES);
+                    intensityKept[blockIndex * channelCount + ch] = static_cast<uint8_t>(
+                        c.type == STEREO_SECONDARY && hcaInfoVersion <= 0x200 && c.intensity[0] >= 15);
+                }
+                noiseSteps[blockIndex] = steps;
+            }
+        });
+
+        // Chain the per-block results from the first block on.
+        _blockEntryRandoms.resize(blockCount);
+        _blockEntryIntensities.resize(blockCount * intensityStride);
+        uint32_t random = hcaInfo.random;
+        std::vector<uint8_t> current(intensityStride, 0);
+        for (uint32_t blockIndex = 0; blockIndex < blockCount; ++blockIndex) {
+            _blockEntryRandoms[blockIndex] = random;
+            memcpy(&_blockEntryIntensities[blockIndex * intensityStride], current.data(), intensityStride);
+
+            for (auto i = noiseSteps[blockIndex]; i > 0; --i) {
+                random = 0x343FD * random + 0x269EC3;
+            }
+            for (uint32_t ch = 0; ch < channelCount; ++ch) {
+                const auto *blockIntensity = &intensities[blockIndex * intensityStride + ch * HCA_SUBFRAMES];
+                auto *currentIntensity = &current[ch * HCA_SUBFRAMES];
+                if (intensityKept[blockIndex * channelCount + ch]) {
+                    currentIntensity[0] = blockIntensity[0];
+                } else {
+                    memcpy(currentIntensity, blockIntensity, HCA_SUBFRAMES);
+                }
+            }
+        }
+
+        _blockEntryStateCount = blockCount;
+    }
+
+    void CHcaDecoder::RestoreBlockEntryState(uint32_t blockIndex, stChannel *channels, uint32_t *random) {
+        const auto &hcaInfo = _hcaInfo;
+        // The first block starts with the initial state.
+        if (!_hasCarriedBlockState || blockIndex == 0) {
+            *random = hcaInfo.random;
+            return;
+        }
+        *random = _blockEntryRandoms[blockIndex];
+        const auto intensityStride = hcaInfo.channelCount * HCA_SUBFRAMES;
+        for (uint32_t ch = 0; ch < hcaInfo.channelCount; ++ch) {
+            memcpy(channels[ch].intensity, &_blockEntryIntensities[blockIndex * intensityStride + ch * HCA_SUBFRAMES], HCA_SUBFRAMES);
+        }
+    }
+
+    uint64_t CHcaDecoder::DecodeBlocks(uint32_t firstBlock, uint32_t blockCount, uint8_t *buffer, uint64_t bufferSize, uint32_t threadCount) {
+        const auto &hcaInfo = _hcaInfo;
+        const auto waveBlockSize = GetWaveBlockSize();
+        if (!buffer || firstBlock > hcaInfo.blockCount || blockCount > hcaInfo.blockCount - firstBlock ||
+            bufferSize < static_cast<uint64_t>(blockCount) * waveBlockSize) {
+            throw CArgumentException("CHcaDecoder::DecodeBlocks");
+        }
+
+        DecodeBlockRange(firstBlock, blockCount, threadCount, [&](uint32_t blockIndex, const stChannel *channels) {
+            GenerateWaveData(channels, buffer + static_cast<uint64_t>(blockIndex - firstBlock) * waveBlockSize);
+        });
+
+        return static_cast<uint64_t>(blockCount) * waveBlockSize;
+    }
+
+    uint64_t CHcaDecoder::DecodeBlocksPlanarFloat(uint32_t firstBlock, uint32_t blockCount, float **channels, uint32_t threadCount) {
+        const auto &hcaInfo = _hcaInfo;
+        if (!channels || firstBlock > hcaInfo.blockCount || blockCount > hcaInfo.blockCount - firstBlock) {
+            throw CArgumentException("CHcaDecoder::DecodeBlocksPlanarFloat");
+        }
+        for (uint32_t k = 0; k < hcaInfo.channelCount; ++k) {
+            if (!channels[k]) {
+                throw CArgumentException("CHcaDecoder::DecodeBlocksPlanarFloat");
+            }
+        }
+
+        const uint32_t samplesPerBlock = HCA_SUBFRAMES * HCA_SAMPLES_PER_SUBFRAME;
+        DecodeBlockRange(firstBlock, blockCount, threadCount, [&](uint32_t blockIndex, const stChannel *blockChannels) {
+            const auto sampleOffset = static_cast<uint64_t>(blockIndex - firstBlock) * samplesPerBlock;
+            for (uint32_t k = 0; k < hcaInfo.channelCount; ++k) {
+                // A single channel "interleaves" to itself, so the float converter writes the plane as-is.
+                const float *plane = &blockChannels[k].wave[0][0];
+                CDefaultWaveGenerator::DecodeFloatBlock(&plane, 1, samplesPerBlock, hcaInfo.rvaVolume,
+                                                        reinterpret_cast<uint8_t *>(channels[k] + sampleOffset));
+            }
+        });
+
+        return static_cast<uint64_t>(blockCount) * samplesPerBlock;
+    }
+
+    void CHcaDecoder::DecodeBlockRange(uint32_t firstBlock, uint32_t blockCount, uint32_t threadCount,
+                                       const std::function<void(uint32_t, const stChannel *)> &output) {
+        if (blockCount == 0) {
+            return;
+        }
+
+        const auto &hcaInfo = _hcaInfo;
+        // Chunks restore the state of the block before them; the last one needed is the one before the last chunk.
+        if (_hasCarriedBlockState && firstBlock + blockCount - 1 > _blockEntryStateCount) {
+            BuildBlockEntryStates(threadCount);
+        }
+
+        const auto blockSize = hcaInfo.blockSize;
+        const auto channelCount = hcaInfo.channelCount;
+        std::mutex streamMutex;
+        const uint32_t chunkBlockCount = ParallelChunkBlockCount;
+        const auto chunkCount = (blockCount + chunkBlockCount - 1) / chunkBlockCount;
+
+        CParallel::For(chunkCount, threadCount, [&](uint32_t chunk) {
+            const auto first = firstBlock + chunk * chunkBlockCount;
+            const auto count = std::min(chunkBlockCount, firstBlock + blockCount - first);
+            // Decode the block before the chunk once and throw away its output, so that the IMDCT overlap
+            // (and everything else carried from block to block) is in the same state as in a sequential decode.
+            const auto preRoll = first > 0 ? 1u : 0u;
+            const auto readFirst = first - preRoll;
+            const auto readCount = count + preRoll;
+            std::vector<uint8_t> hcaBlocks(readCount * blockSize);
+            std::vector<stChannel> channels(channelCount);
+            uint32_t random;
+            {
+                std::lock_guard<std::mutex> lock(streamMutex);
+                _baseStream->Seek(hcaInfo.dataOffset + blockSize * readFirst, StreamSeekOrigin::Begin);
+                const auto actualRead = _baseStream->Read(hcaBlocks.data(), readCount * blockSize, 0, readCount * blockSize);
+                if (actualRead < readCount * blockSize) {
+                    throw CException(CGSS_OP_DECODE_FAILED);
+                }
+            }
+            VerifyBlocks(hcaBlocks.data(), readCount);
+            ResetChannelStates(channels.data());
+            RestoreBlockEntryState(readFirst, channels.data(), &random);
+            for (uint32_t i = 0; i < readCount; ++i) {
+                auto hcaBlockBuffer = hcaBlocks.data() + i * blockSize;
+                DecodeBlockData(hcaBlockBuffer, channels.data(), &random);
+                if (i >= preRoll) {
+                    output(readFirst + i, channels.data());
+                }
+            }
+        });
+    }
+
+    uint64_t CHcaDecoder::GetCacheHitCount() {
+        return _blockCache->GetHitCount();
+    }
+
+    uint64_t CHcaDecoder::GetCacheMissCount() {
+        return _blockCache->GetMissCount();
     }
 
     uint64_t CHcaDecoder::GetPosition() {
@@ -393,52 +772,77 @@ CGSS_NS_BEGIN
 
     uint64_t CHcaDecoder::MapLoopedPosition(uint64_t linearPosition) {
         const auto &decoderConfig = _decoderConfig;
-        const auto waveHeaderSize = decoderConfig.waveHeaderEnabled ? GetWaveHeaderSize() : 0;
         const auto &hcaInfo = _hcaInfo;
         if (!hcaInfo.loopExists || !decoderConfig.loopEnabled) {
             return linearPosition;
         }
 
-        // Now, linearPosition points to the audio data.
-        const auto waveBlockSize = GetWaveBlockSize();
-        const auto beforeLoopStart = hcaInfo.loopStart > 1 ? hcaInfo.loopStart - 1 : 0;
-        const auto inLoop = hcaInfo.loopEnd - hcaInfo.loopStart + 1;
-        if (linearPosition <= waveHeaderSize + (beforeLoopStart + inLoop) * waveBlockSize) {
+        const auto waveHeaderSize = decoderConfig.waveHeaderEnabled ? GetWaveHeaderSize() : 0;
+        if (linearPosition < waveHeaderSize) {
+            return linearPosition;
+        }
+
+        // Blocks [loopStart, loopEnd] are played loopCount times, so the position maps back in constant time.
+        const uint64_t waveBlockSize = GetWaveBlockSize();
+        const auto loopStartPosition = hcaInfo.loopStart * waveBlockSize;
+        const auto loopLength = GetLoopBlockCount() * waveBlockSize;
+        const auto audioPosition = linearPosition - waveHeaderSize;
+        if (audioPosition < loopStartPosition + loopLength) {
             return linearPosition;
         }
 
         if (decoderConfig.loopCount == 0) {
             throw CArgumentException("CHcaDecoder::MapLoopedPosition");
         }
-        auto loopCount = (linearPosition - waveHeaderSize - beforeLoopStart * waveBlockSize) / (inLoop * waveBlockSize);
-        loopCount = std::min(static_cast<uint32_t>(loopCount), decoderConfig.loopCount);
-        return linearPosition - loopCount * inLoop * waveBlockSize - waveHeaderSize;
+        const auto loopedLength = loopLength * decoderConfig.loopCount;
+        if (audioPosition < loopStartPosition + loopedLength) {
+            return waveHeaderSize + loopStartPosition + (audioPosition - loopStartPosition) % loopLength;
+        } else {
+            return linearPosition - loopLength * (decoderConfig.loopCount - 1);
+        }
     }
 
-    uint64_t CHcaDecoder::GetLength() {
+    uint32_t CHcaDecoder::GetLoopBlockCount() {
+        const auto &hcaInfo = _hcaInfo;
+        return hcaInfo.loopEnd - hcaInfo.loopStart + 1;
+    }
+
+    uint64_t CHcaDecoder::GetSampleCount() {
         const auto &hcaInfo = _hcaInfo;
         const auto &decoderConfig = _decoderConfig;
+        uint64_t blockCount = hcaInfo.blockCount;
         if (hcaInfo.loopExists && decoderConfig.loopEnabled) {
             if (decoderConfig.loopCount == 0) {
-                throw CArgumentException("CHcaDecoder::GetLength");
-            }
-            uint64_t total = 0;
-            if (decoderConfig.waveHeaderEnabled) {
-                total += GetWaveHeaderSize();
-            }
-            const auto beforeLoopStart = hcaInfo.loopStart > 1 ? hcaInfo.loopStart - 1 : 0;
-            const auto afterLoopEnd = hcaInfo.loopEnd < hcaInfo.blockCount - 1 ? hcaInfo.blockCount - 1 - hcaInfo.loopEnd : 0;
-            const auto inLoop = hcaInfo.loopEnd - hcaInfo.loopStart + 1;
-            total += (beforeLoopStart + afterLoopEnd) * GetWaveBlockSize();
-            total += inLoop * decoderConfig.loopCount * GetWaveBlockSize();
-            return total;
-        } else {
-            if (decoderConfig.waveHeaderEnabled) {
-                return GetWaveHeaderSize() + GetWaveBlockSize() * hcaInfo.blockCount;
-            } else {
-                return GetWaveBlockSize() * hcaInfo.blockCount;
+                throw CArgumentException("CHcaDecoder::GetSampleCount");
             }
+            blockCount += static_cast<uint64_t>(GetLoopBlockCount()) * (decoderConfig.loopCount - 1);
         }
+        return blockCount * HCA_SUBFRAMES * HCA_SAMPLES_PER_SUBFRAME;
+    }
+
+    uint64_t CHcaDecoder::GetLength() {
+        const auto &decoderConfig = _decoderConfig;
+        const auto waveHeaderSize = decoderConfig.waveHeaderEnabled ? GetWaveHeaderSize() : 0;
+        const auto bytesPerSample = GetWaveBlockSize() / (HCA_SUBFRAMES * HCA_SAMPLES_PER_SUBFRAME);
+        return waveHeaderSize + GetSampleCount() * bytesPerSample;
+    }
+
+    uint64_t CHcaDecoder::GetSamplePosition() {
+        const auto &decoderConfig = _decoderConfig;
+        const auto waveHeaderSize = decoderConfig.waveHeaderEnabled ? GetWaveHeaderSize() : 0;
+        const auto bytesPerSample = GetWaveBlockSize() / (HCA_SUBFRAMES * HCA_SAMPLES_PER_SUBFRAME);
+        const auto position = GetPosition();
+        return position > waveHeaderSize ? (position - waveHeaderSize) / bytesPerSample : 0;
+    }
+
+    void CHcaDecoder::SetSamplePosition(uint64_t sampleIndex) {
+        if (sampleIndex > GetSampleCount()) {
+            throw CArgumentException("CHcaDecoder::SetSamplePosition");
+        }
+        const auto &decoderConfig = _decoderConfig;
+        const auto waveHeaderSize = decoderConfig.waveHeaderEnabled ? GetWaveHeaderSize() : 0;
+        const auto bytesPerSample = GetWaveBlockSize() / (HCA_SUBFRAMES * HCA_SAMPLES_PER_SUBFRAME);
+        SetPosition(waveHeaderSize + sampleIndex * bytesPerSample);
     }
 
     uint32_t CHcaDecoder::Read(void *buffer, uint32_t bufferSize, size_t offset, uint32_t count) {
@@ -453,46 +857,85 @@ CGSS_NS_BEGIN
 
         const auto &decoderConfig = _decoderConfig;
         auto streamPosition = GetPosition();
-        auto mappedPosition = MapLoopedPosition(streamPosition);
         const auto waveStreamLength = GetLength();
-        if (mappedPosition >= waveStreamLength) {
-            return 0;
-        }
-
         const auto waveHeaderSize = decoderConfig.waveHeaderEnabled ? GetWaveHeaderSize() : 0;
+        const auto waveBlockSize = GetWaveBlockSize();
         uint32_t totalRead = 0;
-        if (mappedPosition < waveHeaderSize) {
-            const auto headerLeftLength = static_cast<size_t>(waveHeaderSize - mappedPosition);
-            const auto headerCopyLength = std::min(static_cast<uint32_t>(headerLeftLength), bufferSize);
-            memcpy(byteBuffer + offset, GenerateWaveHeader() + mappedPosition, headerCopyLength);
-            streamPosition += headerCopyLength;
-            if (bufferSize <= headerCopyLength) {
-                SetPosition(streamPosition);
-                return bufferSize;
-            }
-            bufferSize -= headerCopyLength;
-            offset += headerCopyLength;
-            totalRead += headerCopyLength;
-            mappedPosition += headerCopyLength;
-        }
 
-        // Now mappedPosition is pointed inside audio data.
-        const auto waveBlockSize = GetWaveBlockSize();
-        while (bufferSize > 0 && mappedPosition < waveStreamLength) {
-            const auto blockIndex = static_cast<uint32_t>((mappedPosition - waveHeaderSize) / waveBlockSize);
-            const auto startOffset = (mappedPosition - waveHeaderSize) % waveBlockSize;
-            const auto blockData = DecodeBlock(blockIndex);
-            const auto copyLength = std::min(waveStreamLength - mappedPosition, std::min(waveBlockSize - startOffset, static_cast<uint64_t>(bufferSize)));
-            memcpy(byteBuffer + offset, blockData + startOffset, static_cast<size_t>(copyLength));
+        // Positions are mapped one block at a time, so reads can run across loop boundaries.
+        while (bufferSize > 0 && streamPosition < waveStreamLength) {
+            const auto mappedPosition = MapLoopedPosition(streamPosition);
+            const uint8_t *data;
+            uint64_t available;
+            if (mappedPosition < waveHeaderSize) {
+                data = GenerateWaveHeader() + mappedPosition;
+                available = waveHeaderSize - mappedPosition;
+            } else {
+                const auto blockIndex = static_cast<uint32_t>((mappedPosition - waveHeaderSize) / waveBlockSize);
+                const auto startOffset = static_cast<uint32_t>((mappedPosition - waveHeaderSize) % waveBlockSize);
+                // Decoding a block that does not follow the last decoded one pre-rolls the block before it.
+                data = DecodeBlock(blockIndex) + startOffset;
+                available = waveBlockSize - startOffset;
+            }
+            const auto copyLength = static_cast<uint32_t>(std::min(std::min(available, waveStreamLength - streamPosition), static_cast<uint64_t>(bufferSize)));
+            memcpy(byteBuffer + offset, data, copyLength);
             streamPosition += copyLength;
             bufferSize -= copyLength;
             offset += copyLength;
             totalRead += copyLength;
-            mappedPosition += copyLength;
         }
 
         SetPosition(streamPosition);
         return totalRead;
     }
 
+    uint64_t CHcaDecoder::DecodeTo(const std::function<void(const uint8_t *data, uint32_t size)> &sink) {
+        const auto &decoderConfig = _decoderConfig;
+        auto streamPosition = GetPosition();
+        const auto waveStreamLength = GetLength();
+        const auto waveHeaderSize = decoderConfig.waveHeaderEnabled ? GetWaveHeaderSize() : 0;
+        const auto waveBlockSize = GetWaveBlockSize();
+        uint64_t totalWritten = 0;
+
+        // The same walk as Read(), but each span goes to the sink where it is, instead of being copied out.
+        while (streamPosition < waveStreamLength) {
+            const auto mappedPosition = MapLoopedPosition(streamPosition);
+            const uint8_t *data;
+            uint64_t available;
+            if (mappedPosition < waveHeaderSize) {
+                data = GenerateWaveHeader() + mappedPosition;
+                available = waveHeaderSize - mappedPosition;
+            } else {
+                const auto blockIndex = static_cast<uint32_t>((mappedPosition - waveHeaderSize) / waveBlockSize);
+                const auto startOffset = static_cast<uint32_t>((mappedPosition - waveHeaderSize) % waveBlockSize);
+                data = _blockCache->Find(blockIndex);
+                if (!data) {
+                    if (!_waveBlockBuffer) {
+                        _waveBlockBuffer = new uint8_t[waveBlockSize];
+                    }
+                    DecodeBlock(blockIndex, _waveBlockBuffer);
+                    data = _waveBlockBuffer;
+                }
+                data += startOffset;
+                available = waveBlockSize - startOffset;
+            }
+            const auto spanLength = static_cast<uint32_t>(std::min(available, waveStreamLength - streamPosition));
+            sink(data, spanLength);
+            streamPosition += spanLength;
+            totalWritten += spanLength;
+            SetPosition(streamPosition);
+        }
+
+        return totalWritten;
+    }
+
+    uint64_t CHcaDecoder::DecodeTo(IStream *stream) {
+        if (!stream) {
+            throw CArgumentException("CHcaDecoder::DecodeTo");
+        }
+        return DecodeTo([stream](const uint8_t *data, uint32_t size) {
+            stream->Write(data, size, 0, size);
+        });
+    }
+
 CGSS_NS_END
@@ -1,6 +1,7 @@
 #pragma once
 
-#include <map>
+#include <functional>
+#include <vector>
 #include "../../cgss_data.h"
 #include "CHcaFormatReader.h"
 #include "CHcaDecoder_vgmstream.h"
@@ -13,6 +14,8 @@ CGSS_NS_BEGIN
 
     class CHcaChannel;
 
+    class CHcaBlockCache;
+
     class CGSS_EXPORT CHcaDecoder : public CHcaFormatReader {
 
     __extends(CHcaFormatReader, CHcaDecoder);
@@ -35,10 +38,108 @@ CGSS_NS_BEGIN
 
         uint64_t GetLength() override;
 
+        /**
+         * Gets the number of samples (per channel) in the output, including looped repeats.
+         */
+        uint64_t GetSampleCount();
+
+        /**
+         * Gets the index of the sample (per channel) at the current position.
+         */
+        uint64_t GetSamplePosition();
+
+        /**
+         * Moves the current position to a sample (per channel).
+         * @remarks Seeking is cheap: when reading resumes, only the block before the target is decoded (without output)
+         * to rebuild the decoding state, so the output is the same as if everything before had been decoded. With looping
+         * enabled, the sample index counts repeats and maps back to the looped block directly.
+         * @param sampleIndex Sample index, up to GetSampleCount().
+         */
+        void SetSamplePosition(uint64_t sampleIndex);
+
+        /**
+         * Decodes a range of blocks on a pool of worker threads and writes the wave data of the blocks, in order, to the buffer.
+         * @remarks The wave header and looping are not applied; the buffer receives exactly blockCount * GetWaveBlockSize() bytes.
+         * The output is identical to decoding the blocks one by one from the start of the stream. Neither the block cache
+         * nor the stream position is touched.
+         * @param firstBlock Index of the first block to decode.
+         * @param blockCount Number of blocks to decode.
+         * @param buffer Output buffer.
+         * @param bufferSize Size of the output buffer, in bytes.
+         * @param threadCount Maximum number of worker threads. 0 means one per hardware thread.
+         * @return Number of bytes written.
+         */
+        uint64_t DecodeBlocks(uint32_t firstBlock, uint32_t blockCount, uint8_t *buffer, uint64_t bufferSize, uint32_t threadCount);
+
+        /**
+         * Decodes a range of blocks like DecodeBlocks(), but writes one float plane per channel instead of interleaved wave data.
+         * @remarks Samples are scaled by the RVA volume and clamped to [-1, 1], the same values DecodeFloat() would produce,
+         * regardless of the decode function in the config.
+         * @param firstBlock Index of the first block to decode.
+         * @param blockCount Number of blocks to decode.
+         * @param channels One pointer per channel, each to room for blockCount * 1024 floats.
+         * @param threadCount Maximum number of worker threads. 0 means one per hardware thread.
+         * @return Number of samples written to each channel.
+         */
+        uint64_t DecodeBlocksPlanarFloat(uint32_t firstBlock, uint32_t blockCount, float **channels, uint32_t threadCount);
+
+        /**
+         * Decodes from the current position to the end and passes the output to a sink, one span at a time.
+         * @remarks The spans are the data Read() would return, in order: the rest of the wave header, then the wave data of
+         * the blocks, with looping applied. A block that is not in the block cache is decoded into a buffer of the decoder and
+         * passed from there, without being cached or copied. A span is only valid during the call. The position is at the end afterwards.
+         * @param sink Receives the spans. If it throws, decoding stops and the position is at the start of that span.
+         * @return Number of bytes passed to the sink.
+         */
+        uint64_t DecodeTo(const std::function<void(const uint8_t *data, uint32_t size)> &sink);
+
+        /**
+         * Decodes from the current position to the end like DecodeTo(sink), writing the output to a stream.
+         * @return Number of bytes written.
+         */
+        uint64_t DecodeTo(IStream *stream);
+
+        /**
+         * Computes the minimum size required for generated wave header.
+         * @return Computed size.
+         */
+        uint32_t GetWaveHeaderSize();
+
+        /**
+         * Computes the minimum size required for decoded wave data block.
+         * @return Computed size.
+         */
+        uint32_t GetWaveBlockSize();
+
+        /**
+         * Gets the sample format of the wave data, with the default in the config resolved.
+         */
+        HcaWaveFormat GetWaveFormat() const;
+
+        /**
+         * Gets the number of block reads served from the decoded block cache.
+         */
+        uint64_t GetCacheHitCount();
+
+        /**
+         * Gets the number of block reads that had to decode the block.
+         */
+        uint64_t GetCacheMissCount();
+
     private:
 
         void InitializeExtra();
 
+        /**
+         * Resolves the sample format from the config, and picks the matching built-in decode function if none is set.
+         */
+        void InitializeWaveFormat();
+
+        /**
+         * Gets the size of one sample of one channel in the wave data.
+         */
+        uint32_t GetWaveBytesPerSample() const;
+
         /**
          * Generate a wave header for decoded file.
          * @remarks You can use GetWaveHeaderSize() to determine the header size before trying to get wave header data.
@@ -47,12 +148,6 @@ CGSS_NS_BEGIN
          */
         const uint8_t *GenerateWaveHeader();
 
-        /**
-         * Computes the minimum size required for generated wave header.
-         * @return Computed size.
-         */
-        uint32_t GetWaveHeaderSize();
-
         /**
          * Continue to decode upcoming blocks, from HCA to wave audio, and write decoded data to data buffer.
          * @remarks You can use ComputeWaveBlockSize() to determine the minimum size for the data buffer before trying to decode.
@@ -64,10 +159,73 @@ CGSS_NS_BEGIN
         const uint8_t *DecodeBlock(uint32_t blockIndex);
 
         /**
-         * Computes the minimum size required for decoded wave data block.
-         * @return Computed size.
+         * Decodes a block to a buffer of GetWaveBlockSize() bytes, without using the block cache.
          */
-        uint32_t GetWaveBlockSize();
+        void DecodeBlock(uint32_t blockIndex, uint8_t *waveBlockBuffer);
+
+        /**
+         * Reads a raw block from the base stream and verifies it.
+         * @see VerifyBlocks
+         */
+        void ReadBlock(uint32_t blockIndex, uint8_t *hcaBlockBuffer);
+
+        /**
+         * Moves the sequential decoding state to the start of a block, by restoring the state the previous block starts with
+         * and decoding that block without output.
+         */
+        void PreRollBlock(uint32_t blockIndex);
+
+        /**
+         * Puts channel states into the state they have before the first block is decoded.
+         */
+        void ResetChannelStates(stChannel *channels);
+
+        /**
+         * Verifies the checksums of contiguous raw blocks, decrypts them in place and checks their sync words.
+         */
+        void VerifyBlocks(uint8_t *hcaBlockBuffer, uint32_t blockCount);
+
+        /**
+         * Unpacks the frame values (scale factors, intensities, resolutions and gains) of a verified block.
+         * @param br Bit reader positioned right after the sync word.
+         */
+        void UnpackBlockHeader(clData *br, stChannel *channels);
+
+        /**
+         * Decodes a verified block into the wave planes of the channels.
+         * @param random Noise generator state, advanced by the block.
+         */
+        void DecodeBlockData(const uint8_t *hcaBlockBuffer, stChannel *channels, uint32_t *random);
+
+        /**
+         * Converts the wave planes of the channels to output samples with the configured decode function.
+         */
+        void GenerateWaveData(const stChannel *channels, uint8_t *waveBlockBuffer);
+
+        /**
+         * Whether decoding a block depends on anything from previous blocks other than the IMDCT overlap,
+         * i.e. the noise generator runs or stereo intensities can be carried over.
+         */
+        bool_t HasCarriedBlockState();
+
+        /**
+         * Scans all blocks once and records the noise generator state and stereo intensities each block starts with.
+         * @remarks The sequential decoding path records them as it goes, so this is only needed to jump ahead of it.
+         */
+        void BuildBlockEntryStates(uint32_t threadCount);
+
+        /**
+         * Puts channel states and the noise generator into the state the block starts with, except for the IMDCT overlap.
+         * @remarks The entry state of the block must be known if HasCarriedBlockState() is true.
+         */
+        void RestoreBlockEntryState(uint32_t blockIndex, stChannel *channels, uint32_t *random);
+
+        /**
+         * Decodes blocks in chunks on worker threads and hands every decoded block to the output callback.
+         * @remarks The callback may be called concurrently, for different blocks, and in any order.
+         */
+        void DecodeBlockRange(uint32_t firstBlock, uint32_t blockCount, uint32_t threadCount,
+                              const std::function<void(uint32_t, const stChannel *)> &output);
 
         /**
          * Map a linear position to a looped position, considering looping range.
@@ -76,21 +234,42 @@ CGSS_NS_BEGIN
          */
         uint64_t MapLoopedPosition(uint64_t linearPosition);
 
-        std::map<uint32_t, const uint8_t *> _decodedBlocks;
+        /**
+         * Gets the number of blocks in the looping range, from loop start to loop end, both inclusive.
+         */
+        uint32_t GetLoopBlockCount();
 
         static const uint32_t ChannelCount = 0x10;
+        static const uint32_t InvalidBlockIndex = 0xffffffff;
 
         CHcaAth *_ath;
         CHcaCipher *_cipher;
         HCA_DECODER_CONFIG _decoderConfig;
+        HcaWaveFormat _waveFormat;
         CHcaChannel *_channels[ChannelCount];
         uint32_t _waveHeaderSize;
         uint8_t *_waveHeaderBuffer;
         uint32_t _waveBlockSize;
         uint8_t *_hcaBlockBuffer;
+        // Output of blocks decoded by DecodeTo().
+        uint8_t *_waveBlockBuffer;
+        CHcaBlockCache *_blockCache;
         // Position measured by wave output.
         uint64_t _position;
         stChannel* _channels_vgmstream;
+        // Noise generator state of the sequential decoding path.
+        uint32_t _random;
+        // The block the sequential decoding state is positioned at, or InvalidBlockIndex.
+        uint32_t _nextBlockIndex;
+
+        static const uint32_t ParallelChunkBlockCount = 32;
+
+        bool_t _hasCarriedBlockState;
+        // Entry states are known for blocks [0, _blockEntryStateCount).
+        uint32_t _blockEntryStateCount;
+        std::vector<uint32_t> _blockEntryRandoms;
+        // Stereo intensities each block starts with, HCA_SUBFRAMES per channel per block.
+        std::vector<uint8_t> _blockEntryIntensities;
 
     };
 
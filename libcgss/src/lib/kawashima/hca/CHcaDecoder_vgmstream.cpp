@@ -27,6 +27,7 @@
   //--------------------------------------------------
 #include "CHcaDecoder.h"
 #include "CHcaDecoder_vgmstream.h"
+#include "../../common/cpu_features.h"
 #include <stddef.h>
 #include <stdlib.h>
 #include <memory.h>
@@ -87,15 +88,60 @@
 //--------------------------------------------------
 // Bitstream reader
 //--------------------------------------------------
+static int bitreader_legacy_enabled = 0;
+
 void bitreader_init(clData* br, const void* data, int size) {
     br->data = (const unsigned char*)data;
     br->size = size * 8;
     br->bit = 0;
+    br->cache = 0;
+    br->legacy = bitreader_legacy_enabled;
+    /* forces a refill on the first peek; the previous reader is used in place of refills, so its cache stays empty */
+    br->cache_bit = br->legacy ? 0x7FFFFFFF : 1;
+}
+
+void bitreader_use_legacy(int enabled) {
+    bitreader_legacy_enabled = enabled;
+}
+
+static inline unsigned long long bitreader_load_be64(const unsigned char* data) {
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64) || defined(_M_ARM) || defined(_M_ARM64))
+    unsigned long long v;
+    memcpy(&v, data, sizeof(v));
+    return _byteswap_uint64(v);
+#elif defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    unsigned long long v;
+    memcpy(&v, data, sizeof(v));
+    return __builtin_bswap64(v);
+#else
+    unsigned long long v = 0;
+    int i;
+    for (i = 0; i < 8; i++)
+        v = (v << 8) | data[i];
+    return v;
+#endif
+}
+
+/* loads the 8 bytes around the read position into the cache (zero padded past the end of the block) */
+static void bitreader_refill(clData* br) {
+    const int byte = br->bit >> 3;
+    const int size_bytes = br->size >> 3;
+
+    br->cache_bit = byte * 8;
+    if (byte + 8 <= size_bytes) {
+        br->cache = bitreader_load_be64(&br->data[byte]);
+    }
+    else {
+        unsigned long long v = 0;
+        int i;
+        for (i = 0; i < 8; i++)
+            v = (v << 8) | (byte + i < size_bytes ? br->data[byte + i] : 0);
+        br->cache = v;
+    }
 }
 
-/* CRI's bitreader only handles 16b max during decode (header just reads bytes)
- * so maybe could be optimized by ignoring higher cases */
-static unsigned int bitreader_peek(clData* br, int bitsize) {
+/* the previous reader, kept to check the cached one against (see bitreader_use_legacy) */
+static unsigned int bitreader_peek_legacy(clData* br, int bitsize) {
     const unsigned int bit = br->bit;
     const unsigned int bit_rem = bit & 7;
     const unsigned int size = br->size;
@@ -107,6 +153,9 @@ static unsigned int bitreader_peek(clData* br, int bitsize) {
 
     bit_offset = bitsize + bit_rem;
     bit_left = size - bit;
+    /* when the bytes spanned do not fit in the bits left, the branches below shift by a negative count (0 on x86) */
+    if (bit_offset > 8 && bit_left < ((bit_offset + 7) & ~7u))
+        return 0;
     if (bit_left >= 32 && bit_offset >= 25) {
         static const unsigned int mask[8] = {
                 0xFFFFFFFF,0x7FFFFFFF,0x3FFFFFFF,0x1FFFFFFF,
@@ -154,6 +203,38 @@ static unsigned int bitreader_peek(clData* br, int bitsize) {
     return v;
 }
 
+/* CRI's bitreader only handles 16b max during decode (header just reads bytes). After a refill at least
+ * 57 bits are cached, so one refill covers several reads, and small backward skips stay inside the cache. */
+static inline unsigned int bitreader_peek(clData* br, int bitsize) {
+    int offset;
+
+    /* a read ending 14 bits or more before the end of the block spans at most bitsize + 14 bits of whole bytes */
+    if (br->bit + bitsize > br->size - 14) {
+        const int bit_offset = (br->bit & 7) + bitsize;
+
+        if (br->legacy)
+            return bitreader_peek_legacy(br, bitsize);
+        if (!(br->bit + bitsize <= br->size))
+            return 0;
+        /* The original reader picked a 4, 3, 2 or 1 byte load from the bits left after the read position, so a read
+         * spanning more bytes than that (one ending in the checksum at the end of the block) shifted by a negative
+         * count. That came out as 0 on x86, and decoded output depends on it, so such reads still return 0. */
+        if (bit_offset > 8 && br->bit + ((bit_offset + 7) & ~7) > br->size)
+            return 0;
+    }
+
+    offset = br->bit - br->cache_bit;
+    /* offset 64 (a 0-bit read right after the cache) would be an undefined shift below */
+    if (offset < 0 || offset >= 64 || offset + bitsize > 64) {
+        if (br->legacy)
+            return bitreader_peek_legacy(br, bitsize);
+        bitreader_refill(br);
+        offset = br->bit - br->cache_bit;
+    }
+    /* shifting in two steps keeps bitsize 0 defined */
+    return (unsigned int)((br->cache << offset) >> 1 >> (63 - bitsize));
+}
+
 unsigned int bitreader_read(clData* br, int bitsize) {
     unsigned int v = bitreader_peek(br, bitsize);
     br->bit += bitsize;
@@ -919,7 +1000,8 @@ static const float* hcaimdct_window_float = (const float*)hcaimdct_window_float_
 
 /* apply DCT-IV to dequantized spectra to get final samples */
 //HCAIMDCT_Transform
-void imdct_transform(stChannel* ch, int subframe) {
+/* scalar IMDCT, also the reference for the SIMD versions below */
+static void imdct_transform_scalar(stChannel* ch, int subframe) {
     static const unsigned int size = HCA_SAMPLES_PER_SUBFRAME;
     static const unsigned int half = HCA_SAMPLES_PER_SUBFRAME / 2;
     static const unsigned int mdct_bits = HCA_MDCT_BITS;
@@ -1041,3 +1123,323 @@ void imdct_transform(stChannel* ch, int subframe) {
 #endif
     }
 }
+
+#ifdef __CGSS_SIMD_X86__
+/* SIMD versions of the IMDCT above. They do the same float operations in the same order (no FMA), so results are
+ * bit-identical to the scalar version. Buffers in stChannel are not guaranteed to be aligned, hence unaligned loads. */
+
+/* pre-pre-rotation pass: pairs (a,b) of src become a+b and a-b, grouped by count2 */
+CGSS_TARGET_SSE2
+static void imdct_butterfly_sse(const float* src, float* dst, unsigned int count1, unsigned int count2) {
+    unsigned int j, k;
+
+    if (count2 >= 4) {
+        for (j = 0; j < count1; j++) {
+            float* d1 = &dst[j * count2 * 2];
+            float* d2 = d1 + count2;
+
+            for (k = 0; k < count2; k += 4) {
+                __m128 v0 = _mm_loadu_ps(src);
+                __m128 v1 = _mm_loadu_ps(src + 4);
+                __m128 a = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 b = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1));
+                _mm_storeu_ps(d1 + k, _mm_add_ps(a, b));
+                _mm_storeu_ps(d2 + k, _mm_sub_ps(a, b));
+                src += 8;
+            }
+        }
+    }
+    else if (count2 == 2) {
+        /* two groups of [a0+b0, a1+b1, a0-b0, a1-b1] per 8 inputs */
+        for (j = 0; j < count1; j += 2) {
+            __m128 v0 = _mm_loadu_ps(src);
+            __m128 v1 = _mm_loadu_ps(src + 4);
+            __m128 a = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 b = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1));
+            __m128 sum = _mm_add_ps(a, b);
+            __m128 diff = _mm_sub_ps(a, b);
+            _mm_storeu_ps(dst, _mm_shuffle_ps(sum, diff, _MM_SHUFFLE(1, 0, 1, 0)));
+            _mm_storeu_ps(dst + 4, _mm_shuffle_ps(sum, diff, _MM_SHUFFLE(3, 2, 3, 2)));
+            src += 8;
+            dst += 8;
+        }
+    }
+    else {
+        /* groups of [a+b, a-b] */
+        for (j = 0; j < count1; j += 4) {
+            __m128 v0 = _mm_loadu_ps(src);
+            __m128 v1 = _mm_loadu_ps(src + 4);
+            __m128 a = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 b = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1));
+            __m128 sum = _mm_add_ps(a, b);
+            __m128 diff = _mm_sub_ps(a, b);
+            _mm_storeu_ps(dst, _mm_unpacklo_ps(sum, diff));
+            _mm_storeu_ps(dst + 4, _mm_unpackhi_ps(sum, diff));
+            src += 8;
+            dst += 8;
+        }
+    }
+}
+
+/* rotation pass: in each group of count2 * 2, x = first half and y = second half become
+ * x*sin - y*cos (forwards) and x*cos + y*sin (backwards from the end of the group) */
+CGSS_TARGET_SSE2
+static void imdct_rotate_sse(const float* src, float* dst, const float* sin_table, const float* cos_table,
+    unsigned int count1, unsigned int count2) {
+    unsigned int j, k;
+
+    if (count2 >= 4) {
+        for (j = 0; j < count1; j++) {
+            const float* s1 = &src[j * count2 * 2];
+            const float* s2 = s1 + count2;
+            float* d1 = &dst[j * count2 * 2];
+            float* d2 = d1 + count2 * 2;
+
+            for (k = 0; k < count2; k += 4) {
+                __m128 x = _mm_loadu_ps(s1 + k);
+                __m128 y = _mm_loadu_ps(s2 + k);
+                __m128 sin = _mm_loadu_ps(sin_table);
+                __m128 cos = _mm_loadu_ps(cos_table);
+                __m128 lo = _mm_sub_ps(_mm_mul_ps(x, sin), _mm_mul_ps(y, cos));
+                __m128 hi = _mm_add_ps(_mm_mul_ps(x, cos), _mm_mul_ps(y, sin));
+                _mm_storeu_ps(d1 + k, lo);
+                _mm_storeu_ps(d2 - k - 4, _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(0, 1, 2, 3)));
+                sin_table += 4;
+                cos_table += 4;
+            }
+        }
+    }
+    else if (count2 == 2) {
+        /* two groups of [x0 x1 y0 y1] per 8 inputs */
+        for (j = 0; j < count1; j += 2) {
+            __m128 v0 = _mm_loadu_ps(src);
+            __m128 v1 = _mm_loadu_ps(src + 4);
+            __m128 x = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(1, 0, 1, 0));
+            __m128 y = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 2, 3, 2));
+            __m128 sin = _mm_loadu_ps(sin_table);
+            __m128 cos = _mm_loadu_ps(cos_table);
+            __m128 lo = _mm_sub_ps(_mm_mul_ps(x, sin), _mm_mul_ps(y, cos));
+            __m128 hi = _mm_add_ps(_mm_mul_ps(x, cos), _mm_mul_ps(y, sin));
+            hi = _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(2, 3, 0, 1));
+            _mm_storeu_ps(dst, _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(1, 0, 1, 0)));
+            _mm_storeu_ps(dst + 4, _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 2, 3, 2)));
+            src += 8;
+            dst += 8;
+            sin_table += 4;
+            cos_table += 4;
+        }
+    }
+    else {
+        /* groups of [x y] */
+        for (j = 0; j < count1; j += 4) {
+            __m128 v0 = _mm_loadu_ps(src);
+            __m128 v1 = _mm_loadu_ps(src + 4);
+            __m128 x = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 y = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1));
+            __m128 sin = _mm_loadu_ps(sin_table);
+            __m128 cos = _mm_loadu_ps(cos_table);
+            __m128 lo = _mm_sub_ps(_mm_mul_ps(x, sin), _mm_mul_ps(y, cos));
+            __m128 hi = _mm_add_ps(_mm_mul_ps(x, cos), _mm_mul_ps(y, sin));
+            _mm_storeu_ps(dst, _mm_unpacklo_ps(lo, hi));
+            _mm_storeu_ps(dst + 4, _mm_unpackhi_ps(lo, hi));
+            src += 8;
+            dst += 8;
+            sin_table += 4;
+            cos_table += 4;
+        }
+    }
+}
+
+CGSS_TARGET_SSE2
+static void imdct_window_sse(stChannel* ch, int subframe) {
+    static const unsigned int size = HCA_SAMPLES_PER_SUBFRAME;
+    static const unsigned int half = HCA_SAMPLES_PER_SUBFRAME / 2;
+    const float* dct = &ch->spectra[subframe][0];
+    const float* window = hcaimdct_window_float;
+    float* prev = &ch->imdct_previous[0];
+    float* wave = &ch->wave[subframe][0];
+    unsigned int i;
+
+    for (i = 0; i < half; i += 4) {
+        __m128 prev_lo = _mm_loadu_ps(prev + i);
+        __m128 prev_hi = _mm_loadu_ps(prev + half + i);
+        __m128 dct_lo_rev = _mm_loadu_ps(dct + half - i - 4);
+        __m128 dct_hi_rev = _mm_loadu_ps(dct + size - i - 4);
+        __m128 window_lo_rev = _mm_loadu_ps(window + half - i - 4);
+        __m128 window_hi_rev = _mm_loadu_ps(window + size - i - 4);
+        dct_lo_rev = _mm_shuffle_ps(dct_lo_rev, dct_lo_rev, _MM_SHUFFLE(0, 1, 2, 3));
+        dct_hi_rev = _mm_shuffle_ps(dct_hi_rev, dct_hi_rev, _MM_SHUFFLE(0, 1, 2, 3));
+        window_lo_rev = _mm_shuffle_ps(window_lo_rev, window_lo_rev, _MM_SHUFFLE(0, 1, 2, 3));
+        window_hi_rev = _mm_shuffle_ps(window_hi_rev, window_hi_rev, _MM_SHUFFLE(0, 1, 2, 3));
+
+        _mm_storeu_ps(wave + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(window + i), _mm_loadu_ps(dct + half + i)), prev_lo));
+        _mm_storeu_ps(wave + half + i, _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(window + half + i), dct_hi_rev), prev_hi));
+        _mm_storeu_ps(prev + i, _mm_mul_ps(window_hi_rev, dct_lo_rev));
+        _mm_storeu_ps(prev + half + i, _mm_mul_ps(window_lo_rev, _mm_loadu_ps(dct + i)));
+    }
+}
+
+CGSS_TARGET_SSE2
+static void imdct_transform_sse(stChannel* ch, int subframe) {
+    static const unsigned int half = HCA_SAMPLES_PER_SUBFRAME / 2;
+    static const unsigned int mdct_bits = HCA_MDCT_BITS;
+    float* spectra = &ch->spectra[subframe][0];
+    float* temp = &ch->temp[0];
+    unsigned int i;
+
+    /* same ping-pong between spectra and temp as the scalar version, ending in temp */
+    for (i = 0; i < mdct_bits; i++) {
+        if (i & 1)
+            imdct_butterfly_sse(temp, spectra, 1 << i, half >> i);
+        else
+            imdct_butterfly_sse(spectra, temp, 1 << i, half >> i);
+    }
+
+    /* ending in spectra */
+    for (i = 0; i < mdct_bits; i++) {
+        const float* sin_table = (const float*)sin_tables_hex[i];
+        const float* cos_table = (const float*)cos_tables_hex[i];
+        if (i & 1)
+            imdct_rotate_sse(spectra, temp, sin_table, cos_table, half >> i, 1 << i);
+        else
+            imdct_rotate_sse(temp, spectra, sin_table, cos_table, half >> i, 1 << i);
+    }
+
+    imdct_window_sse(ch, subframe);
+}
+
+CGSS_TARGET_AVX
+static inline __m256 imdct_reverse_avx(__m256 v) {
+    v = _mm256_permute2f128_ps(v, v, 1);
+    return _mm256_permute_ps(v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+CGSS_TARGET_AVX
+static void imdct_butterfly_avx(const float* src, float* dst, unsigned int count1, unsigned int count2) {
+    unsigned int j, k;
+
+    if (count2 < 8) {
+        imdct_butterfly_sse(src, dst, count1, count2);
+        return;
+    }
+
+    for (j = 0; j < count1; j++) {
+        float* d1 = &dst[j * count2 * 2];
+        float* d2 = d1 + count2;
+
+        for (k = 0; k < count2; k += 8) {
+            __m256 v0 = _mm256_loadu_ps(src);
+            __m256 v1 = _mm256_loadu_ps(src + 8);
+            /* shuffles work per 128-bit lane, so regroup first: [a0 b0 a1 b1 a4 b4 a5 b5], [a2 b2 a3 b3 a6 b6 a7 b7] */
+            __m256 t0 = _mm256_permute2f128_ps(v0, v1, 0x20);
+            __m256 t1 = _mm256_permute2f128_ps(v0, v1, 0x31);
+            __m256 a = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(2, 0, 2, 0));
+            __m256 b = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm256_storeu_ps(d1 + k, _mm256_add_ps(a, b));
+            _mm256_storeu_ps(d2 + k, _mm256_sub_ps(a, b));
+            src += 16;
+        }
+    }
+}
+
+CGSS_TARGET_AVX
+static void imdct_rotate_avx(const float* src, float* dst, const float* sin_table, const float* cos_table,
+    unsigned int count1, unsigned int count2) {
+    unsigned int j, k;
+
+    if (count2 < 8) {
+        imdct_rotate_sse(src, dst, sin_table, cos_table, count1, count2);
+        return;
+    }
+
+    for (j = 0; j < count1; j++) {
+        const float* s1 = &src[j * count2 * 2];
+        const float* s2 = s1 + count2;
+        float* d1 = &dst[j * count2 * 2];
+        float* d2 = d1 + count2 * 2;
+
+        for (k = 0; k < count2; k += 8) {
+            __m256 x = _mm256_loadu_ps(s1 + k);
+            __m256 y = _mm256_loadu_ps(s2 + k);
+            __m256 sin = _mm256_loadu_ps(sin_table);
+            __m256 cos = _mm256_loadu_ps(cos_table);
+            __m256 lo = _mm256_sub_ps(_mm256_mul_ps(x, sin), _mm256_mul_ps(y, cos));
+            __m256 hi = _mm256_add_ps(_mm256_mul_ps(x, cos), _mm256_mul_ps(y, sin));
+            _mm256_storeu_ps(d1 + k, lo);
+            _mm256_storeu_ps(d2 - k - 8, imdct_reverse_avx(hi));
+            sin_table += 8;
+            cos_table += 8;
+        }
+    }
+}
+
+CGSS_TARGET_AVX
+static void imdct_window_avx(stChannel* ch, int subframe) {
+    static const unsigned int size = HCA_SAMPLES_PER_SUBFRAME;
+    static const unsigned int half = HCA_SAMPLES_PER_SUBFRAME / 2;
+    const float* dct = &ch->spectra[subframe][0];
+    const float* window = hcaimdct_window_float;
+    float* prev = &ch->imdct_previous[0];
+    float* wave = &ch->wave[subframe][0];
+    unsigned int i;
+
+    for (i = 0; i < half; i += 8) {
+        __m256 prev_lo = _mm256_loadu_ps(prev + i);
+        __m256 prev_hi = _mm256_loadu_ps(prev + half + i);
+        __m256 dct_lo_rev = imdct_reverse_avx(_mm256_loadu_ps(dct + half - i - 8));
+        __m256 dct_hi_rev = imdct_reverse_avx(_mm256_loadu_ps(dct + size - i - 8));
+        __m256 window_lo_rev = imdct_reverse_avx(_mm256_loadu_ps(window + half - i - 8));
+        __m256 window_hi_rev = imdct_reverse_avx(_mm256_loadu_ps(window + size - i - 8));
+
+        _mm256_storeu_ps(wave + i, _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(window + i), _mm256_loadu_ps(dct + half + i)), prev_lo));
+        _mm256_storeu_ps(wave + half + i, _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(window + half + i), dct_hi_rev), prev_hi));
+        _mm256_storeu_ps(prev + i, _mm256_mul_ps(window_hi_rev, dct_lo_rev));
+        _mm256_storeu_ps(prev + half + i, _mm256_mul_ps(window_lo_rev, _mm256_loadu_ps(dct + i)));
+    }
+}
+
+CGSS_TARGET_AVX
+static void imdct_transform_avx(stChannel* ch, int subframe) {
+    static const unsigned int half = HCA_SAMPLES_PER_SUBFRAME / 2;
+    static const unsigned int mdct_bits = HCA_MDCT_BITS;
+    float* spectra = &ch->spectra[subframe][0];
+    float* temp = &ch->temp[0];
+    unsigned int i;
+
+    for (i = 0; i < mdct_bits; i++) {
+        if (i & 1)
+            imdct_butterfly_avx(temp, spectra, 1 << i, half >> i);
+        else
+            imdct_butterfly_avx(spectra, temp, 1 << i, half >> i);
+    }
+
+    for (i = 0; i < mdct_bits; i++) {
+        const float* sin_table = (const float*)sin_tables_hex[i];
+        const float* cos_table = (const float*)cos_tables_hex[i];
+        if (i & 1)
+            imdct_rotate_avx(spectra, temp, sin_table, cos_table, half >> i, 1 << i);
+        else
+            imdct_rotate_avx(temp, spectra, sin_table, cos_table, half >> i, 1 << i);
+    }
+
+    imdct_window_avx(ch, subframe);
+}
+#endif
+
+typedef void (*imdct_transform_func)(stChannel* ch, int subframe);
+
+static imdct_transform_func select_imdct_transform(void) {
+#ifdef __CGSS_SIMD_X86__
+    const cgss::CpuFeatures& features = cgss::GetCpuFeatures();
+    if (features.avx)
+        return imdct_transform_avx;
+    if (features.sse2)
+        return imdct_transform_sse;
+#endif
+    return imdct_transform_scalar;
+}
+
+void imdct_transform(stChannel* ch, int subframe) {
+    static const imdct_transform_func func = select_imdct_transform();
+    func(ch, subframe);
+}
@@ -10,8 +10,11 @@ extern "C" {
     typedef enum { DISCRETE = 0, STEREO_PRIMARY = 1, STEREO_SECONDARY = 2 } channel_type_t;
     typedef struct clData {
         const unsigned char* data;
-        int size;
-        int bit;
+        int size;                   /* in bits */
+        int bit;                    /* read position, in bits */
+        unsigned long long cache;   /* 64 bits of data starting at cache_bit, first bit in the MSB */
+        int cache_bit;              /* byte aligned; cache is empty while cache_bit > bit */
+        int legacy;                 /* read through the previous reader instead of the cache */
     } clData;
     typedef struct stChannel {
         /* HCA channel config */
@@ -40,6 +43,9 @@ extern "C" {
 
     void bitreader_init(clData* br, const void* data, int size);
     unsigned int bitreader_read(clData* br, int bitsize);
+    /* Makes readers initialized afterwards use the previous (uncached) implementation, for comparing the two.
+     * Not synchronized: call it while no block is being decoded. */
+    void bitreader_use_legacy(int enabled);
 
     int unpack_scalefactors(stChannel* ch, clData* br, unsigned int hfr_group_count, unsigned int version);
 
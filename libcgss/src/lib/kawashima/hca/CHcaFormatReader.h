@@ -41,8 +41,29 @@ CGSS_NS_BEGIN
 
         void Flush() final;
 
+        /**
+         * Checks whether the stream starts with valid HCA headers.
+         * @remarks Only the headers are read. It does not throw, and the stream position is restored.
+         */
         static bool_t IsPossibleHcaStream(IStream *stream);
 
+        /**
+         * Gets the size of HCA headers (the data offset) from the first bytes of a file, without validating the headers.
+         * @param header Data from the start of the file.
+         * @param headerSize Size of the data, in bytes. At least 8 bytes are needed.
+         * @return The size of the headers, or 0 if the data does not start like an HCA file.
+         */
+        static uint32_t GetHeaderSize(const void *header, uint32_t headerSize);
+
+        /**
+         * Parses and validates HCA headers in memory. It does not throw.
+         * @param header Data from the start of the file, at least GetHeaderSize() bytes.
+         * @param headerSize Size of the data, in bytes.
+         * @param info Parsed HCA information. It is left unspecified if the headers are invalid.
+         * @return Whether the headers are valid.
+         */
+        static bool_t TryParseHeader(const void *header, uint32_t headerSize, HCA_INFO &info);
+
     protected:
 
         static uint16_t ComputeChecksum(void *pData, uint32_t dwDataSize, uint16_t wInitSum);
@@ -55,9 +76,14 @@ CGSS_NS_BEGIN
 
         void Initialize();
 
-        void PrintHcaInfo();
+        /**
+         * Parses HCA headers in memory.
+         * @param errorMessage Receives the reason when parsing fails. Can be nullptr.
+         * @return CGSS_OP_OK, CGSS_OP_FORMAT_ERROR or CGSS_OP_CHECKSUM_ERROR.
+         */
+        static CGSS_OP_RESULT ParseHeader(const uint8_t *header, uint32_t headerSize, HCA_INFO &info, const char **errorMessage);
 
-        static const uint16_t *ChecksumTable;
+        void PrintHcaInfo();
 
     };
 
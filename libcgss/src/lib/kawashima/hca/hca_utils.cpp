@@ -1,9 +0,0 @@
-
-#include "hca_utils.h"
-
-CGSS_NS_BEGIN
-
-    const uint32_t WaveSettings::BitPerChannel = 16;
-    const bool_t WaveSettings::SoftLoop = FALSE;
-
-CGSS_NS_END
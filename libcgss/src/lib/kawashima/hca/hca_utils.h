@@ -5,17 +5,6 @@
 
 CGSS_NS_BEGIN
 
-    struct WaveSettings final {
-        /**
-         * Bit per channel. Future acceptable values will be 8, 16, 24, 32 and 0 (floating point wave data).
-         */
-        static const uint32_t BitPerChannel;
-        static const bool_t SoftLoop;
-
-    PURE_STATIC(WaveSettings);
-
-    };
-
     enum class Magic : uint32_t {
 
         HCA = 0x00414348,
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include "CHcaBlockCache.h"
+
+#ifdef _MSC_VER
+#undef max
+#undef min
+#endif
+
+CGSS_NS_BEGIN
+
+    CHcaBlockCache::CHcaBlockCache(uint32_t blockCount, uint32_t blockSize, uint64_t byteBudget)
+        : _blockSize(blockSize), _hitCount(0), _missCount(0), _buffers(blockCount, nullptr), _lruPositions(blockCount),
+          _allocatedCount(0) {
+        if (byteBudget == 0 || blockSize == 0) {
+            _capacity = blockCount;
+        } else {
+            _capacity = static_cast<uint32_t>(std::min<uint64_t>(byteBudget / blockSize, blockCount));
+        }
+        // The caller copies out of the last returned block, so that one must stay.
+        _capacity = std::max(_capacity, 1u);
+    }
+
+    CHcaBlockCache::~CHcaBlockCache() {
+        for (auto buffer : _buffers) {
+            delete[] buffer;
+        }
+        for (auto buffer : _freeBuffers) {
+            delete[] buffer;
+        }
+    }
+
+    const uint8_t *CHcaBlockCache::Find(uint32_t blockIndex) {
+        const auto buffer = _buffers[blockIndex];
+        if (!buffer) {
+            ++_missCount;
+            return nullptr;
+        }
+        ++_hitCount;
+        _lru.splice(_lru.begin(), _lru, _lruPositions[blockIndex]);
+        return buffer;
+    }
+
+    uint8_t *CHcaBlockCache::Allocate(uint32_t blockIndex) {
+        uint8_t *buffer;
+        if (!_freeBuffers.empty()) {
+            buffer = _freeBuffers.back();
+            _freeBuffers.pop_back();
+        } else if (_allocatedCount < _capacity) {
+            buffer = new uint8_t[_blockSize];
+            ++_allocatedCount;
+        } else {
+            const auto evicted = _lru.back();
+            _lru.pop_back();
+            buffer = _buffers[evicted];
+            _buffers[evicted] = nullptr;
+        }
+        _buffers[blockIndex] = buffer;
+        _lru.push_front(blockIndex);
+        _lruPositions[blockIndex] = _lru.begin();
+        return buffer;
+    }
+
+    void CHcaBlockCache::Remove(uint32_t blockIndex) {
+        const auto buffer = _buffers[blockIndex];
+        if (!buffer) {
+            return;
+        }
+        _lru.erase(_lruPositions[blockIndex]);
+        _buffers[blockIndex] = nullptr;
+        _freeBuffers.push_back(buffer);
+    }
+
+    uint64_t CHcaBlockCache::GetHitCount() const {
+        return _hitCount;
+    }
+
+    uint64_t CHcaBlockCache::GetMissCount() const {
+        return _missCount;
+    }
+
+    uint32_t CHcaBlockCache::GetCapacity() const {
+        return _capacity;
+    }
+
+CGSS_NS_END
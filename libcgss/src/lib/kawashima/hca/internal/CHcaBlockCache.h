@@ -0,0 +1,69 @@
+#pragma once
+
+#include <list>
+#include <vector>
+#include "../../../cgss_env.h"
+
+CGSS_NS_BEGIN
+
+    /**
+     * Least recently used cache of decoded wave blocks with a byte budget.
+     * Buffers are allocated up to the budget and then reused for new blocks when old ones are evicted.
+     */
+    class CHcaBlockCache {
+
+    public:
+
+        /**
+         * @param blockCount Number of blocks in the stream.
+         * @param blockSize Size of a decoded block, in bytes.
+         * @param byteBudget Maximum total size of cached blocks, in bytes. 0 means unlimited. At least one block is always kept.
+         */
+        CHcaBlockCache(uint32_t blockCount, uint32_t blockSize, uint64_t byteBudget);
+
+        CHcaBlockCache(const CHcaBlockCache &) = delete;
+
+        ~CHcaBlockCache();
+
+        /**
+         * Looks up a block and marks it as most recently used.
+         * @return The cached data, or nullptr if the block is not cached.
+         */
+        const uint8_t *Find(uint32_t blockIndex);
+
+        /**
+         * Gets a buffer to decode a block into, evicting the least recently used block if the cache is full.
+         * The block counts as cached (and most recently used) from now on.
+         */
+        uint8_t *Allocate(uint32_t blockIndex);
+
+        /**
+         * Forgets a block, e.g. when decoding into its buffer failed. The buffer goes back to the pool.
+         */
+        void Remove(uint32_t blockIndex);
+
+        uint64_t GetHitCount() const;
+
+        uint64_t GetMissCount() const;
+
+        uint32_t GetCapacity() const;
+
+    private:
+
+        uint32_t _blockSize;
+        uint32_t _capacity;
+        uint64_t _hitCount;
+        uint64_t _missCount;
+        // Per block index: buffer, or nullptr if not cached.
+        std::vector<uint8_t *> _buffers;
+        // Per block index: position in _lru, valid while cached.
+        std::vector<std::list<uint32_t>::iterator> _lruPositions;
+        // Cached block indices, most recently used first.
+        std::list<uint32_t> _lru;
+        // Buffers not holding any block.
+        std::vector<uint8_t *> _freeBuffers;
+        uint32_t _allocatedCount;
+
+    };
+
+CGSS_NS_END
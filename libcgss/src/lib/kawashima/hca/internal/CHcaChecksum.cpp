@@ -0,0 +1,84 @@
+#include "CHcaChecksum.h"
+
+CGSS_NS_BEGIN
+
+    namespace {
+
+        // Tables[k][b] is the checksum contribution of byte b followed by k zero bytes ("slicing-by-8").
+        struct ChecksumTables {
+
+            uint16_t values[8][256];
+
+            ChecksumTables() {
+                for (uint32_t b = 0; b < 256; ++b) {
+                    auto c = static_cast<uint16_t>(b << 8);
+                    for (auto i = 0; i < 8; ++i) {
+                        c = static_cast<uint16_t>((c & 0x8000) ? (c << 1) ^ 0x8005 : c << 1);
+                    }
+                    values[0][b] = c;
+                }
+                for (uint32_t k = 1; k < 8; ++k) {
+                    for (uint32_t b = 0; b < 256; ++b) {
+                        const auto prev = values[k - 1][b];
+                        values[k][b] = static_cast<uint16_t>((prev << 8) ^ values[0][prev >> 8]);
+                    }
+                }
+            }
+
+        };
+
+        const ChecksumTables &GetTables() {
+            static const ChecksumTables tables;
+            return tables;
+        }
+
+        inline uint16_t Update8(const uint16_t (*t)[256], uint16_t sum, const uint8_t *p) {
+            return static_cast<uint16_t>(t[7][p[0] ^ (sum >> 8)] ^ t[6][p[1] ^ (sum & 0xff)] ^
+                                         t[5][p[2]] ^ t[4][p[3]] ^ t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]]);
+        }
+
+        inline uint16_t Update1(const uint16_t (*t)[256], uint16_t sum, uint8_t b) {
+            return static_cast<uint16_t>((sum << 8) ^ t[0][(sum >> 8) ^ b]);
+        }
+
+    }
+
+    uint16_t CHcaChecksum::Compute(const void *data, uint32_t size, uint16_t initSum) {
+        const auto t = GetTables().values;
+        auto p = static_cast<const uint8_t *>(data);
+        auto sum = initSum;
+        for (; size >= 8; size -= 8, p += 8) {
+            sum = Update8(t, sum, p);
+        }
+        for (; size > 0; --size, ++p) {
+            sum = Update1(t, sum, *p);
+        }
+        return sum;
+    }
+
+    uint16_t CHcaChecksum::ComputeAndSubstitute(uint8_t *data, uint32_t size, const uint8_t *table, uint16_t initSum) {
+        if (!table) {
+            return Compute(data, size, initSum);
+        }
+        const auto t = GetTables().values;
+        auto p = data;
+        auto sum = initSum;
+        for (; size >= 8; size -= 8, p += 8) {
+            sum = Update8(t, sum, p);
+            p[0] = table[p[0]];
+            p[1] = table[p[1]];
+            p[2] = table[p[2]];
+            p[3] = table[p[3]];
+            p[4] = table[p[4]];
+            p[5] = table[p[5]];
+            p[6] = table[p[6]];
+            p[7] = table[p[7]];
+        }
+        for (; size > 0; --size, ++p) {
+            sum = Update1(t, sum, *p);
+            *p = table[*p];
+        }
+        return sum;
+    }
+
+CGSS_NS_END
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "../../../cgss_env.h"
+
+CGSS_NS_BEGIN
+
+    /**
+     * CRC-16 (polynomial 0x8005, MSB first) used by HCA headers and blocks, computed 8 bytes at a time.
+     */
+    class CHcaChecksum {
+
+        PURE_STATIC(CHcaChecksum);
+
+    public:
+
+        static uint16_t Compute(const void *data, uint32_t size, uint16_t initSum);
+
+        /**
+         * Computes the checksum of the data and replaces every byte with its entry in the table, in the same pass.
+         * @param table Substitution table of 256 entries. If it is nullptr, the data is left as is.
+         * @return Checksum of the data before substitution.
+         */
+        static uint16_t ComputeAndSubstitute(uint8_t *data, uint32_t size, const uint8_t *table, uint16_t initSum);
+
+    };
+
+CGSS_NS_END
@@ -1,4 +1,5 @@
 #include "CHcaCipher.h"
+#include "CHcaChecksum.h"
 #include "../../../cgss_cdata.h"
 
 static void TransformKey(uint32_t key1, uint32_t key2, uint16_t mod, uint32_t *pk1, uint32_t *pk2) {
@@ -77,6 +78,21 @@ CGSS_NS_BEGIN
         }
     }
 
+    bool_t CHcaCipher::VerifyAndDecrypt(uint8_t *data, uint32_t size) const {
+        // Without a cipher the table is the identity, so skip the substitution.
+        const auto table = _cipherType == HcaCipherType::NoCipher ? nullptr : _decryptTable;
+        return static_cast<bool_t>(CHcaChecksum::ComputeAndSubstitute(data, size, table, 0) == 0);
+    }
+
+    uint32_t CHcaCipher::VerifyAndDecryptBlocks(uint8_t *data, uint32_t blockSize, uint32_t blockCount) const {
+        for (uint32_t i = 0; i < blockCount; ++i) {
+            if (!VerifyAndDecrypt(data + static_cast<size_t>(i) * blockSize, blockSize)) {
+                return i;
+            }
+        }
+        return blockCount;
+    }
+
     void CHcaCipher::Encrypt(uint8_t *data, uint32_t size) const {
         for (uint8_t *d = data; size > 0; d++, size--) {
             *d = _encryptTable[*d];
@@ -23,6 +23,18 @@ CGSS_NS_BEGIN
 
         void Decrypt(uint8_t *data, uint32_t size) const;
 
+        /**
+         * Verifies the checksum of a block and decrypts it, in a single pass over the data.
+         * @return Whether the checksum is valid. The block is decrypted either way.
+         */
+        bool_t VerifyAndDecrypt(uint8_t *data, uint32_t size) const;
+
+        /**
+         * Verifies and decrypts contiguous blocks, stopping at the first one with an invalid checksum.
+         * @return Number of blocks verified and decrypted before the invalid one, or blockCount if all are valid.
+         */
+        uint32_t VerifyAndDecryptBlocks(uint8_t *data, uint32_t blockSize, uint32_t blockCount) const;
+
         void Encrypt(uint8_t *data, uint32_t size) const;
 
     private:
@@ -8,6 +8,7 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <dirent.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -15,6 +16,7 @@
 #endif
 
 #include "CFileSystem.h"
+#include "CPath.h"
 
 using namespace cgss;
 
@@ -68,6 +70,48 @@ bool_t CFileSystem::DirectoryExists(const char *path) {
     }
 }
 
+bool_t CFileSystem::GetFileInfo(const char *path, uint64_t *size, int64_t *lastWriteTime) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+
+    if (!GetFileAttributesEx(path, GetFileExInfoStandard, &data) || (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        return FALSE;
+    }
+
+    *size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    *lastWriteTime = (static_cast<int64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+
+    return TRUE;
+}
+
+bool_t CFileSystem::GetFilesRecursive(const std::string &directory, std::vector<std::string> &files) {
+    WIN32_FIND_DATA data;
+    const auto handle = FindFirstFile(CPath::Combine(directory, "*").c_str(), &data);
+
+    if (handle == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    do {
+        if (strcmp(data.cFileName, ".") == 0 || strcmp(data.cFileName, "..") == 0) {
+            continue;
+        }
+
+        const auto path = CPath::Combine(directory, data.cFileName);
+
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            if (!(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+                GetFilesRecursive(path, files);
+            }
+        } else {
+            files.push_back(path);
+        }
+    } while (FindNextFile(handle, &data));
+
+    FindClose(handle);
+
+    return TRUE;
+}
+
 // http://blog.nuclex-games.com/2012/06/how-to-create-directories-recursively-with-win32/
 bool_t CFileSystem::MkDir(const char *path) {
     static const std::string separators("\\/");
@@ -119,6 +163,58 @@ bool_t CFileSystem::DirectoryExists(const char *path) {
     }
 }
 
+bool_t CFileSystem::GetFileInfo(const char *path, uint64_t *size, int64_t *lastWriteTime) {
+    struct stat info {};
+
+    if (::stat(path, &info) != 0 || !(info.st_mode & S_IFREG)) {
+        return FALSE;
+    }
+
+    // In nanoseconds: st_mtime alone misses a rewrite within the same second.
+#if defined(__APPLE__)
+    const auto &modificationTime = info.st_mtimespec;
+#else
+    const auto &modificationTime = info.st_mtim;
+#endif
+
+    *size = static_cast<uint64_t>(info.st_size);
+    *lastWriteTime = static_cast<int64_t>(modificationTime.tv_sec) * 1000000000 + modificationTime.tv_nsec;
+
+    return TRUE;
+}
+
+bool_t CFileSystem::GetFilesRecursive(const std::string &directory, std::vector<std::string> &files) {
+    const auto dir = opendir(directory.c_str());
+
+    if (dir == nullptr) {
+        return FALSE;
+    }
+
+    while (const auto entry = readdir(dir)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        const auto path = CPath::Combine(directory, entry->d_name);
+        struct stat info {};
+
+        // lstat() so that links to directories are not followed; links to files are listed.
+        if (::lstat(path.c_str(), &info) != 0) {
+            continue;
+        }
+
+        if (S_ISDIR(info.st_mode)) {
+            GetFilesRecursive(path, files);
+        } else if (S_ISREG(info.st_mode) || (S_ISLNK(info.st_mode) && ::stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode))) {
+            files.push_back(path);
+        }
+    }
+
+    closedir(dir);
+
+    return TRUE;
+}
+
 // http://nion.modprobe.de/blog/archives/357-Recursive-directory-creation.html
 bool_t CFileSystem::MkDir(const char *path) {
     if (path == nullptr) {
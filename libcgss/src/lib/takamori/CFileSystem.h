@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "../cgss_env.h"
 
@@ -28,6 +29,20 @@ CGSS_NS_BEGIN
 
         static bool_t RmFile(const char *path);
 
+        /**
+         * Gets the size and the last modification time of a file.
+         * @param lastWriteTime Modification time, in a platform-specific unit; only for comparing with another value from here.
+         * @return FALSE if the file cannot be queried.
+         */
+        static bool_t GetFileInfo(const char *path, uint64_t *size, int64_t *lastWriteTime);
+
+        /**
+         * Lists the files in a directory and, recursively, in its subdirectories.
+         * @remarks Links to directories are not followed. The paths are appended in no particular order.
+         * @return FALSE if the directory cannot be opened. Subdirectories that cannot be opened are skipped.
+         */
+        static bool_t GetFilesRecursive(const std::string &directory, std::vector<std::string> &files);
+
     };
 
 CGSS_NS_END
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include "CParallel.h"
+
+#ifdef _MSC_VER
+#undef max
+#undef min
+#endif
+
+CGSS_NS_BEGIN
+
+    uint32_t CParallel::GetDefaultThreadCount() {
+        const auto n = std::thread::hardware_concurrency();
+        return n > 0 ? n : 1;
+    }
+
+    void CParallel::For(uint32_t count, uint32_t threadCount, const std::function<void(uint32_t)> &body) {
+        if (count == 0) {
+            return;
+        }
+        if (threadCount == 0) {
+            threadCount = GetDefaultThreadCount();
+        }
+        threadCount = std::min(threadCount, count);
+
+        if (threadCount <= 1) {
+            for (uint32_t i = 0; i < count; ++i) {
+                body(i);
+            }
+            return;
+        }
+
+        std::atomic<uint32_t> next(0);
+        std::atomic<bool> failed(false);
+        std::exception_ptr error;
+        std::mutex errorMutex;
+
+        auto worker = [&]() {
+            while (!failed.load()) {
+                const auto i = next.fetch_add(1);
+                if (i >= count) {
+                    break;
+                }
+                try {
+                    body(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    failed.store(true);
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount - 1);
+        for (uint32_t i = 1; i < threadCount; ++i) {
+            try {
+                threads.emplace_back(worker);
+            } catch (const std::system_error &) {
+                // Out of threads: the ones already running (and this one) take the remaining iterations.
+                break;
+            }
+        }
+        worker();
+        for (auto &t : threads) {
+            t.join();
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+CGSS_NS_END
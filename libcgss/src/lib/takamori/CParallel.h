@@ -0,0 +1,33 @@
+#pragma once
+
+#include <functional>
+
+#include "../cgss_env.h"
+
+CGSS_NS_BEGIN
+
+    class CGSS_EXPORT CParallel final {
+
+    PURE_STATIC(CParallel);
+
+    public:
+
+        /**
+         * Gets the number of worker threads to use when the caller does not specify one.
+         * @return Number of hardware threads, at least 1.
+         */
+        static uint32_t GetDefaultThreadCount();
+
+        /**
+         * Runs body(i) for every i in [0, count) on up to threadCount threads (the calling thread included).
+         * Work items are handed out one at a time from a shared counter, so faster threads pick up more items.
+         * If any invocation throws, no new items are started and the first exception is rethrown on the calling thread.
+         * @param count Number of work items.
+         * @param threadCount Maximum number of threads. 0 means GetDefaultThreadCount().
+         * @param body Work item function.
+         */
+        static void For(uint32_t count, uint32_t threadCount, const std::function<void(uint32_t)> &body);
+
+    };
+
+CGSS_NS_END
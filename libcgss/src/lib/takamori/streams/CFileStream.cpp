@@ -1,8 +1,26 @@
+// 64-bit off_t (fseeko, ftello, pread) on 32-bit POSIX systems. Must come before any system header.
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 
 #include "../CFileSystem.h"
 
+#ifdef __CGSS_OS_WINDOWS__
+
+#include <io.h>
+
+#else
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+
+#endif
+
 #ifndef __MINGW_H
 
 #include <algorithm>
@@ -21,6 +39,16 @@ using namespace std;
 #define __FILE_READ_U ("rb+")
 #define __FILE_WRITE_U ("wb+")
 
+// 64-bit file positions; ftell/fseek use long, which is 32 bits on Windows.
+#if defined(_MSC_VER) || defined(__MINGW32__)
+#define __FTELL64(fp) _ftelli64(fp)
+#define __FSEEK64(fp, offset, origin) _fseeki64((fp), (offset), (origin))
+#else
+#define __FTELL64(fp) ftello(fp)
+#define __FSEEK64(fp, offset, origin) fseeko((fp), static_cast<off_t>(offset), (origin))
+static_assert(sizeof(off_t) == 8, "CFileStream needs a 64-bit off_t; build with _FILE_OFFSET_BITS=64.");
+#endif
+
 CGSS_NS_BEGIN
 
     CFileStream::CFileStream(LPCSTR fileName)
@@ -31,16 +59,26 @@ CGSS_NS_BEGIN
         : MyClass(fileName, mode, FileAccess::ReadWrite) {
     }
 
-    CFileStream::CFileStream(LPCSTR fileName, FileMode mode, FileAccess access) {
+    CFileStream::CFileStream(LPCSTR fileName, FileMode mode, FileAccess access)
+        : MyClass(fileName, mode, access, FALSE) {
+    }
+
+    CFileStream::CFileStream(LPCSTR fileName, FileMode mode, FileAccess access, bool_t isPositional) {
+        if (isPositional && access != FileAccess::Read) {
+            throw CException("Mode/Access: incompatible");
+        }
         _mode = mode;
         _access = access;
+        _isPositional = isPositional;
+        _position = 0;
         _fp = OpenFile(fileName);
+        if (_fp) {
+            _file.reset(_fp, fclose);
+        }
     }
 
     CFileStream::~CFileStream() {
-        if (_fp) {
-            fclose(_fp);
-        }
+        _file.reset();
         _fp = nullptr;
     }
 
@@ -51,6 +89,11 @@ CGSS_NS_BEGIN
         if (!IsReadable()) {
             throw CInvalidOperationException("FileStream::Read()");
         }
+        if (_isPositional) {
+            const auto read = ReadAt(_position, buffer, bufferSize, offset, count);
+            _position += read;
+            return read;
+        }
         const auto actualCount = min(static_cast<uint32_t>(bufferSize - offset), count);
         const auto byteBuffer = static_cast<uint8_t *>(buffer);
         const auto actualRead = fread(byteBuffer + offset, 1, actualCount, _fp);
@@ -85,13 +128,19 @@ CGSS_NS_BEGIN
     uint64_t CFileStream::GetPosition() {
         if (_fp == nullptr) {
             return 0;
+        } else if (_isPositional) {
+            return _position;
         } else {
-            return (uint64_t)ftell(_fp);
+            return (uint64_t)__FTELL64(_fp);
         }
     }
 
     void CFileStream::SetPosition(uint64_t value) {
-        fseek(_fp, (long)value, SEEK_SET);
+        if (_isPositional) {
+            _position = value;
+        } else {
+            __FSEEK64(_fp, value, SEEK_SET);
+        }
     }
 
     uint64_t CFileStream::GetLength() {
@@ -99,21 +148,102 @@ CGSS_NS_BEGIN
             return 0;
         }
 
-        auto position = ftell(_fp);
-        fseek(_fp, 0, SEEK_END);
-        auto r = ftell(_fp);
-        fseek(_fp, position, SEEK_SET);
+        if (_isPositional) {
+            // Other streams may share the file, so its position must not be touched.
+#ifdef __CGSS_OS_WINDOWS__
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(_fp))), &fileSize)) {
+                return 0;
+            }
+            return (uint64_t)fileSize.QuadPart;
+#else
+            struct stat st;
+            if (fstat(fileno(_fp), &st) != 0) {
+                return 0;
+            }
+            return (uint64_t)st.st_size;
+#endif
+        }
+
+        auto position = __FTELL64(_fp);
+        __FSEEK64(_fp, 0, SEEK_END);
+        auto r = __FTELL64(_fp);
+        __FSEEK64(_fp, position, SEEK_SET);
         return (uint64_t)r;
     }
 
     void CFileStream::SetLength(uint64_t value) {
-        fseek(_fp, (long)value, SEEK_SET);
+        if (_isPositional) {
+            throw CInvalidOperationException("FileStream::SetLength()");
+        }
+        __FSEEK64(_fp, value, SEEK_SET);
     }
 
     void CFileStream::Flush() {
         fflush(_fp);
     }
 
+    bool_t CFileStream::IsPositional() const {
+        return _isPositional;
+    }
+
+    CFileStream *CFileStream::CreateReader() const {
+        if (!_isPositional) {
+            throw CInvalidOperationException("FileStream::CreateReader()");
+        }
+        auto reader = new CFileStream();
+        reader->_file = _file;
+        reader->_fp = _fp;
+        reader->_mode = _mode;
+        reader->_access = _access;
+        reader->_isReadable = _isReadable;
+        reader->_isWritable = _isWritable;
+        reader->_isSeekable = _isSeekable;
+        reader->_isPositional = TRUE;
+        reader->_position = 0;
+        return reader;
+    }
+
+    uint32_t CFileStream::ReadAt(uint64_t position, void *buffer, uint32_t bufferSize, size_t offset, uint32_t count) const {
+        if (!buffer) {
+            throw CArgumentException("FileStream::ReadAt()");
+        }
+        if (!_isPositional || !_fp) {
+            throw CInvalidOperationException("FileStream::ReadAt()");
+        }
+        const auto actualCount = min(static_cast<uint32_t>(bufferSize - offset), count);
+        auto byteBuffer = static_cast<uint8_t *>(buffer) + offset;
+        uint32_t totalRead = 0;
+#ifdef __CGSS_OS_WINDOWS__
+        const auto handle = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(_fp)));
+        while (totalRead < actualCount) {
+            const auto readPosition = position + totalRead;
+            OVERLAPPED overlapped = {0};
+            overlapped.Offset = static_cast<DWORD>(readPosition & 0xffffffff);
+            overlapped.OffsetHigh = static_cast<DWORD>(readPosition >> 32);
+            DWORD read = 0;
+            // Fails with ERROR_HANDLE_EOF past the end of the file.
+            if (!ReadFile(handle, byteBuffer + totalRead, actualCount - totalRead, &read, &overlapped) || read == 0) {
+                break;
+            }
+            totalRead += read;
+        }
+#else
+        const auto fd = fileno(_fp);
+        while (totalRead < actualCount) {
+            const auto read = pread(fd, byteBuffer + totalRead, actualCount - totalRead, static_cast<off_t>(position + totalRead));
+            if (read < 0 && errno == EINTR) {
+                continue;
+            }
+            if (read <= 0) {
+                break;
+            }
+            totalRead += static_cast<uint32_t>(read);
+        }
+#endif
+        return totalRead;
+    }
+
     FILE *CFileStream::OpenFile(LPCSTR fileName) {
 #define __OUT() throw CException("Mode/Access: out of range")
 #define __CMB() throw CException("Mode/Access: incompatible")
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdio>
+#include <memory>
 #include "CStream.h"
 
 CGSS_NS_BEGIN
@@ -17,6 +18,15 @@ CGSS_NS_BEGIN
 
         CFileStream(LPCSTR fileName, FileMode mode, FileAccess access);
 
+        /**
+         * @param isPositional Whether to open the stream in positional mode.
+         * A positional stream keeps its cursor itself and reads with positional reads (pread, or ReadFile with an offset
+         * on Windows), so it never uses the position of the file handle. Positional streams are read-only:
+         * access must be FileAccess::Read.
+         * @see CreateReader
+         */
+        CFileStream(LPCSTR fileName, FileMode mode, FileAccess access, bool_t isPositional);
+
         virtual ~CFileStream();
 
         virtual uint32_t Read(void *buffer, uint32_t bufferSize, size_t offset, uint32_t count) override;
@@ -39,6 +49,23 @@ CGSS_NS_BEGIN
 
         virtual void Flush() override;
 
+        bool_t IsPositional() const;
+
+        /**
+         * Creates another positional stream over the same open file, with its own cursor at 0.
+         * @remarks Only available on positional streams. The file is closed when the last stream sharing it is deleted.
+         * Streams sharing a file can be used on different threads at the same time, but each of them must still be used
+         * from one thread at a time.
+         * @return The new stream. The caller deletes it.
+         */
+        CFileStream *CreateReader() const;
+
+        /**
+         * Reads from a position in the file without using or moving the cursor.
+         * @remarks Only available on positional streams. It may be called from several threads at once.
+         */
+        uint32_t ReadAt(uint64_t position, void *buffer, uint32_t bufferSize, size_t offset, uint32_t count) const;
+
     protected:
 
         CFileStream() = default;
@@ -53,10 +80,14 @@ CGSS_NS_BEGIN
 
     private:
 
+        std::shared_ptr<FILE> _file;
         FILE *_fp;
         FileMode _mode;
         FileAccess _access;
         bool_t _isReadable, _isWritable, _isSeekable;
+        bool_t _isPositional;
+        // Cursor of a positional stream.
+        uint64_t _position;
 
     };
 
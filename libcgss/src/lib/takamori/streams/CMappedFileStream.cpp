@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <string>
+#include <algorithm>
+
+#include "../../cgss_env.h"
+
+#ifdef __CGSS_OS_WINDOWS__
+
+#include <io.h>
+
+#else
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#endif
+
+#include "CMappedFileStream.h"
+#include "../exceptions/CException.h"
+#include "../exceptions/CArgumentException.h"
+#include "../exceptions/CInvalidOperationException.h"
+
+#ifdef _MSC_VER
+#undef max
+#undef min
+#endif
+
+CGSS_NS_BEGIN
+
+    // The file is opened with stdio like CFileStream, so file names are interpreted the same way.
+    // The mapping keeps the file content alive after the file is closed.
+    static const uint8_t *MapFile(FILE *fp, uint64_t &length) {
+#ifdef __CGSS_OS_WINDOWS__
+        const auto fileHandle = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(fp)));
+        LARGE_INTEGER fileSize;
+        if (fileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(fileHandle, &fileSize)) {
+            return nullptr;
+        }
+        length = static_cast<uint64_t>(fileSize.QuadPart);
+        if (length == 0) {
+            return nullptr;
+        }
+        const auto mappingHandle = CreateFileMapping(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mappingHandle) {
+            return nullptr;
+        }
+        const auto view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mappingHandle);
+        return static_cast<const uint8_t *>(view);
+#else
+        struct stat st;
+        if (fstat(fileno(fp), &st) != 0) {
+            return nullptr;
+        }
+        length = static_cast<uint64_t>(st.st_size);
+        if (length == 0) {
+            return nullptr;
+        }
+        const auto view = mmap(nullptr, static_cast<size_t>(length), PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+        if (view == MAP_FAILED) {
+            return nullptr;
+        }
+        return static_cast<const uint8_t *>(view);
+#endif
+    }
+
+    CMappedFileStream::CMappedFileStream(LPCSTR fileName)
+        : _data(nullptr), _length(0), _position(0) {
+        if (!fileName) {
+            throw CArgumentException("CMappedFileStream::CMappedFileStream()");
+        }
+
+        const auto fp = fopen(fileName, "rb");
+        if (!fp) {
+            throw CException("File doesn't exist: " + std::string(fileName));
+        }
+
+        _data = MapFile(fp, _length);
+        fclose(fp);
+
+        if (!_data && _length > 0) {
+            throw CException("Cannot map file: " + std::string(fileName));
+        }
+    }
+
+    CMappedFileStream::~CMappedFileStream() {
+        if (_data) {
+#ifdef __CGSS_OS_WINDOWS__
+            UnmapViewOfFile(_data);
+#else
+            munmap(const_cast<uint8_t *>(_data), static_cast<size_t>(_length));
+#endif
+        }
+        _data = nullptr;
+    }
+
+    uint32_t CMappedFileStream::Read(void *buffer, uint32_t bufferSize, size_t offset, uint32_t count) {
+        if (!buffer) {
+            throw CArgumentException("CMappedFileStream::Read()");
+        }
+        if (_position >= _length) {
+            return 0;
+        }
+
+        count = static_cast<uint32_t>(std::min<uint64_t>(std::min(count, static_cast<uint32_t>(bufferSize - offset)), _length - _position));
+
+        memcpy(static_cast<uint8_t *>(buffer) + offset, _data + _position, count);
+        _position += count;
+
+        return count;
+    }
+
+    uint64_t CMappedFileStream::GetPosition() {
+        return _position;
+    }
+
+    void CMappedFileStream::SetPosition(uint64_t value) {
+        _position = value;
+    }
+
+    uint64_t CMappedFileStream::GetLength() {
+        return _length;
+    }
+
+    const uint8_t *CMappedFileStream::GetBuffer() const {
+        return _data;
+    }
+
+    bool_t CMappedFileStream::IsReadable() const {
+        return TRUE;
+    }
+
+    bool_t CMappedFileStream::IsWritable() const {
+        return FALSE;
+    }
+
+    bool_t CMappedFileStream::IsSeekable() const {
+        return TRUE;
+    }
+
+    uint32_t CMappedFileStream::Write(const void *buffer, uint32_t bufferSize, size_t offset, uint32_t count) {
+        throw CInvalidOperationException("CMappedFileStream::Write()");
+    }
+
+    void CMappedFileStream::SetLength(uint64_t value) {
+        throw CInvalidOperationException("CMappedFileStream::SetLength()");
+    }
+
+    void CMappedFileStream::Flush() {
+        throw CInvalidOperationException("CMappedFileStream::Flush()");
+    }
+
+CGSS_NS_END
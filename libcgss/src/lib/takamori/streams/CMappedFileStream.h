@@ -0,0 +1,58 @@
+#pragma once
+
+#include "CStream.h"
+
+CGSS_NS_BEGIN
+
+    /**
+     * A read-only stream over a whole file mapped into memory.
+     * @remarks Reads are memcpy from the mapping and seeking only moves the position, so nothing goes through stdio
+     * or the kernel once the file is mapped. GetBuffer() gives direct access to the file content.
+     */
+    class CGSS_EXPORT CMappedFileStream : public CStream {
+
+    __extends(CStream, CMappedFileStream);
+
+    public:
+
+        explicit CMappedFileStream(LPCSTR fileName);
+
+        CMappedFileStream(const CMappedFileStream &) = delete;
+
+        virtual ~CMappedFileStream();
+
+        uint32_t Read(void *buffer, uint32_t bufferSize, size_t offset, uint32_t count) override;
+
+        uint32_t Write(const void *buffer, uint32_t bufferSize, size_t offset, uint32_t count) override;
+
+        bool_t IsWritable() const override;
+
+        bool_t IsReadable() const override;
+
+        bool_t IsSeekable() const override;
+
+        uint64_t GetPosition() override;
+
+        void SetPosition(uint64_t value) override;
+
+        uint64_t GetLength() override;
+
+        void SetLength(uint64_t value) override;
+
+        void Flush() override;
+
+        /**
+         * Gets the start of the mapped file content, which is GetLength() bytes long.
+         * @remarks The pointer stays valid until the stream is deleted. It is null for an empty file.
+         */
+        const uint8_t *GetBuffer() const;
+
+    private:
+
+        const uint8_t *_data;
+        uint64_t _length;
+        uint64_t _position;
+
+    };
+
+CGSS_NS_END
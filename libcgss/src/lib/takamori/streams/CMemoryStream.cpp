@@ -200,9 +200,11 @@ CGSS_NS_BEGIN
         if (!IsResizable()) {
             throw CInvalidOperationException("MemoryStream::EnsureCapacity()");
         }
-        do {
-            capacity = (uint64_t)(capacity * MemoryStreamGrowFactor);
-        } while (capacity < requestedLength);
+        // Growing by the factor alone never leaves a capacity of 0 (or a few bytes).
+        capacity = (uint64_t)(capacity * MemoryStreamGrowFactor);
+        if (capacity < requestedLength) {
+            capacity = requestedLength;
+        }
         SetCapacity(capacity);
     }
 
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include "CReadAheadStream.h"
+#include "../exceptions/CArgumentException.h"
+#include "../exceptions/CInvalidOperationException.h"
+
+#ifdef _MSC_VER
+#undef max
+#undef min
+#endif
+
+CGSS_NS_BEGIN
+
+    // Largest single read on the base stream, so that the consumer can start early after a seek.
+    static const uint32_t ReadAheadChunkSize = 0x10000;
+
+    CReadAheadStream::CReadAheadStream(IStream *baseStream, uint32_t bufferSize)
+        : _baseStream(baseStream), _head(0), _count(0), _generation(0), _endOfStream(FALSE), _stopping(FALSE) {
+        if (!baseStream || !baseStream->IsReadable()) {
+            throw CArgumentException("CReadAheadStream::CReadAheadStream()");
+        }
+
+        if (bufferSize == 0) {
+            bufferSize = DefaultBufferSize;
+        }
+
+        _buffer.resize(bufferSize);
+        _length = baseStream->GetLength();
+        _isSeekable = baseStream->IsSeekable();
+        _position = baseStream->GetPosition();
+
+        _worker = std::thread(&CReadAheadStream::ReadAhead, this);
+    }
+
+    CReadAheadStream::~CReadAheadStream() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = TRUE;
+        }
+        _spaceAvailable.notify_all();
+        _worker.join();
+    }
+
+    void CReadAheadStream::ReadAhead() {
+        const auto capacity = static_cast<uint32_t>(_buffer.size());
+        std::vector<uint8_t> chunk(std::min(capacity, ReadAheadChunkSize));
+        // Where the base stream is, as far as this thread knows.
+        auto basePosition = _position;
+        bool_t isBasePositionKnown = TRUE;
+
+        while (true) {
+            uint64_t readPosition;
+            uint32_t readSize;
+            uint32_t generation;
+
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _spaceAvailable.wait(lock, [this, capacity]() {
+                    return _stopping || (!_endOfStream && _count < capacity);
+                });
+
+                if (_stopping) {
+                    break;
+                }
+
+                readPosition = _position + _count;
+                readSize = std::min(static_cast<uint32_t>(chunk.size()), capacity - _count);
+                generation = _generation;
+            }
+
+            uint32_t read = 0;
+            std::exception_ptr error;
+
+            try {
+                if (!isBasePositionKnown || readPosition != basePosition) {
+                    _baseStream->SetPosition(readPosition);
+                }
+                read = _baseStream->Read(chunk.data(), readSize, 0, readSize);
+                basePosition = readPosition + read;
+                isBasePositionKnown = TRUE;
+            } catch (...) {
+                error = std::current_exception();
+                isBasePositionKnown = FALSE;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+
+                if (generation != _generation) {
+                    // The consumer seeked away while the chunk was read.
+                    continue;
+                }
+
+                const auto tail = (_head + _count) % capacity;
+                const auto firstPart = std::min(read, capacity - tail);
+                memcpy(_buffer.data() + tail, chunk.data(), firstPart);
+                memcpy(_buffer.data(), chunk.data() + firstPart, read - firstPart);
+                _count += read;
+
+                if (error) {
+                    _error = error;
+                    _endOfStream = TRUE;
+                } else if (read < readSize) {
+                    _endOfStream = TRUE;
+                }
+            }
+
+            _dataAvailable.notify_all();
+        }
+    }
+
+    uint32_t CReadAheadStream::Read(void *buffer, uint32_t bufferSize, size_t offset, uint32_t count) {
+        if (!buffer) {
+            throw CArgumentException("CReadAheadStream::Read()");
+        }
+
+        count = std::min(count, static_cast<uint32_t>(bufferSize - offset));
+
+        const auto capacity = static_cast<uint32_t>(_buffer.size());
+        auto output = static_cast<uint8_t *>(buffer) + offset;
+        uint32_t total = 0;
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        while (total < count) {
+            _dataAvailable.wait(lock, [this]() {
+                return _count > 0 || _endOfStream;
+            });
+
+            if (_count == 0) {
+                if (_error) {
+                    auto error = _error;
+                    _error = nullptr;
+                    std::rethrow_exception(error);
+                }
+                break;
+            }
+
+            const auto size = std::min(count - total, _count);
+            const auto firstPart = std::min(size, capacity - _head);
+            memcpy(output + total, _buffer.data() + _head, firstPart);
+            memcpy(output + total + firstPart, _buffer.data(), size - firstPart);
+
+            _head = (_head + size) % capacity;
+            _count -= size;
+            _position += size;
+            total += size;
+
+            _spaceAvailable.notify_all();
+        }
+
+        return total;
+    }
+
+    uint64_t CReadAheadStream::GetPosition() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _position;
+    }
+
+    void CReadAheadStream::SetPosition(uint64_t value) {
+        if (!_isSeekable) {
+            throw CInvalidOperationException("CReadAheadStream::SetPosition()");
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            if (_position <= value && value <= _position + _count) {
+                // Skip forward inside the buffered data.
+                const auto skipped = static_cast<uint32_t>(value - _position);
+                _head = static_cast<uint32_t>((_head + skipped) % _buffer.size());
+                _count -= skipped;
+                _position = value;
+                if (skipped == 0) {
+                    return;
+                }
+            } else {
+                _head = 0;
+                _count = 0;
+                _position = value;
+                ++_generation;
+                _endOfStream = FALSE;
+                _error = nullptr;
+            }
+        }
+
+        _spaceAvailable.notify_all();
+    }
+
+    uint64_t CReadAheadStream::GetLength() {
+        return _length;
+    }
+
+    bool_t CReadAheadStream::IsReadable() const {
+        return TRUE;
+    }
+
+    bool_t CReadAheadStream::IsWritable() const {
+        return FALSE;
+    }
+
+    bool_t CReadAheadStream::IsSeekable() const {
+        return _isSeekable;
+    }
+
+    uint32_t CReadAheadStream::Write(const void *buffer, uint32_t bufferSize, size_t offset, uint32_t count) {
+        throw CInvalidOperationException("CReadAheadStream::Write()");
+    }
+
+    void CReadAheadStream::SetLength(uint64_t value) {
+        throw CInvalidOperationException("CReadAheadStream::SetLength()");
+    }
+
+    void CReadAheadStream::Flush() {
+        throw CInvalidOperationException("CReadAheadStream::Flush()");
+    }
+
+CGSS_NS_END
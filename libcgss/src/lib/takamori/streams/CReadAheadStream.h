@@ -0,0 +1,92 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CStream.h"
+
+CGSS_NS_BEGIN
+
+    /**
+     * A read-only stream that reads its base stream ahead on a background thread, into a bounded ring buffer.
+     * @remarks Useful when producing the data is expensive, e.g. over a CHcaDecoder: the consumer gets decoded
+     * data as soon as it is ready, and the decoder keeps working while the consumer processes it.
+     * The base stream must not be used by anything else while this stream exists.
+     */
+    class CGSS_EXPORT CReadAheadStream : public CStream {
+
+    __extends(CStream, CReadAheadStream);
+
+    public:
+
+        /**
+         * @param baseStream Readable stream to read ahead. Reading starts at its current position.
+         * @param bufferSize Capacity of the ring buffer, in bytes. 0 means DefaultBufferSize.
+         */
+        CReadAheadStream(IStream *baseStream, uint32_t bufferSize);
+
+        CReadAheadStream(const CReadAheadStream &) = delete;
+
+        virtual ~CReadAheadStream();
+
+        /**
+         * Reads buffered data, waiting for the background thread if needed.
+         * @remarks It only returns less than count at the end of the base stream. If reading the base stream failed,
+         * the exception is rethrown here once the data read before the failure is consumed.
+         */
+        uint32_t Read(void *buffer, uint32_t bufferSize, size_t offset, uint32_t count) override;
+
+        uint32_t Write(const void *buffer, uint32_t bufferSize, size_t offset, uint32_t count) override;
+
+        bool_t IsWritable() const override;
+
+        bool_t IsReadable() const override;
+
+        bool_t IsSeekable() const override;
+
+        uint64_t GetPosition() override;
+
+        /**
+         * Moves the read position. Buffered data is kept if the new position is inside it; otherwise the buffer is
+         * dropped and the background thread continues from the new position.
+         */
+        void SetPosition(uint64_t value) override;
+
+        uint64_t GetLength() override;
+
+        void SetLength(uint64_t value) override;
+
+        void Flush() override;
+
+        static const uint32_t DefaultBufferSize = 0x100000;
+
+    private:
+
+        void ReadAhead();
+
+        IStream *_baseStream;
+        uint64_t _length;
+        bool_t _isSeekable;
+
+        std::vector<uint8_t> _buffer;
+        // Ring buffer index of the byte at _position.
+        uint32_t _head;
+        // Number of bytes buffered from _position on.
+        uint32_t _count;
+        uint64_t _position;
+        // Bumped on every seek that drops the buffer, so that a read already in progress is thrown away.
+        uint32_t _generation;
+        bool_t _endOfStream;
+        bool_t _stopping;
+        std::exception_ptr _error;
+
+        std::mutex _mutex;
+        std::condition_variable _dataAvailable;
+        std::condition_variable _spaceAvailable;
+        std::thread _worker;
+
+    };
+
+CGSS_NS_END
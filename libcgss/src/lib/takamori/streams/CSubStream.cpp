@@ -0,0 +1,96 @@
+#include <algorithm>
+#include "CSubStream.h"
+#include "../exceptions/CArgumentException.h"
+#include "../exceptions/CInvalidOperationException.h"
+
+#ifdef _MSC_VER
+#undef max
+#undef min
+#endif
+
+CGSS_NS_BEGIN
+
+    CSubStream::CSubStream(IStream *baseStream, uint64_t offset, uint64_t length)
+        : MyClass(baseStream, offset, length, FALSE) {
+    }
+
+    CSubStream::CSubStream(IStream *baseStream, uint64_t offset, uint64_t length, bool_t disposeBaseStream)
+        : _baseStream(baseStream), _offset(offset), _length(length), _position(0), _disposeBaseStream(disposeBaseStream) {
+        if (!baseStream || !baseStream->IsReadable() || !baseStream->IsSeekable()) {
+            throw CArgumentException("CSubStream::CSubStream()");
+        }
+        const auto baseLength = baseStream->GetLength();
+        if (offset > baseLength || length > baseLength - offset) {
+            throw CArgumentException("CSubStream::CSubStream()");
+        }
+    }
+
+    CSubStream::~CSubStream() {
+        if (_disposeBaseStream) {
+            delete _baseStream;
+        }
+        _baseStream = nullptr;
+    }
+
+    uint32_t CSubStream::Read(void *buffer, uint32_t bufferSize, size_t offset, uint32_t count) {
+        if (!buffer) {
+            throw CArgumentException("CSubStream::Read()");
+        }
+        if (_position >= _length) {
+            return 0;
+        }
+
+        count = static_cast<uint32_t>(std::min<uint64_t>(std::min(count, static_cast<uint32_t>(bufferSize - offset)), _length - _position));
+
+        _baseStream->Seek(_offset + _position, StreamSeekOrigin::Begin);
+        const auto read = _baseStream->Read(buffer, bufferSize, offset, count);
+        _position += read;
+
+        return read;
+    }
+
+    uint64_t CSubStream::GetPosition() {
+        return _position;
+    }
+
+    void CSubStream::SetPosition(uint64_t value) {
+        _position = value;
+    }
+
+    uint64_t CSubStream::GetLength() {
+        return _length;
+    }
+
+    IStream *CSubStream::GetBaseStream() const {
+        return _baseStream;
+    }
+
+    uint64_t CSubStream::GetOffset() const {
+        return _offset;
+    }
+
+    bool_t CSubStream::IsReadable() const {
+        return TRUE;
+    }
+
+    bool_t CSubStream::IsWritable() const {
+        return FALSE;
+    }
+
+    bool_t CSubStream::IsSeekable() const {
+        return TRUE;
+    }
+
+    uint32_t CSubStream::Write(const void *buffer, uint32_t bufferSize, size_t offset, uint32_t count) {
+        throw CInvalidOperationException("CSubStream::Write()");
+    }
+
+    void CSubStream::SetLength(uint64_t value) {
+        throw CInvalidOperationException("CSubStream::SetLength()");
+    }
+
+    void CSubStream::Flush() {
+        throw CInvalidOperationException("CSubStream::Flush()");
+    }
+
+CGSS_NS_END
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "CStream.h"
+
+CGSS_NS_BEGIN
+
+    /**
+     * A read-only view of a range of another stream, with its own position.
+     * @remarks Nothing is copied: every read seeks the base stream to the range and reads from it. Several views
+     * can share a base stream as long as they are used from one thread at a time.
+     */
+    class CGSS_EXPORT CSubStream : public CStream {
+
+    __extends(CStream, CSubStream);
+
+    public:
+
+        /**
+         * @param baseStream Readable and seekable stream that holds the range.
+         * @param offset Offset of the range in the base stream.
+         * @param length Length of the range. It must not go past the end of the base stream.
+         */
+        CSubStream(IStream *baseStream, uint64_t offset, uint64_t length);
+
+        /**
+         * @param disposeBaseStream Whether to delete the base stream when this stream is deleted.
+         * The base stream is not deleted if the constructor throws.
+         */
+        CSubStream(IStream *baseStream, uint64_t offset, uint64_t length, bool_t disposeBaseStream);
+
+        CSubStream(const CSubStream &) = delete;
+
+        virtual ~CSubStream();
+
+        uint32_t Read(void *buffer, uint32_t bufferSize, size_t offset, uint32_t count) override;
+
+        uint32_t Write(const void *buffer, uint32_t bufferSize, size_t offset, uint32_t count) override;
+
+        bool_t IsWritable() const override;
+
+        bool_t IsReadable() const override;
+
+        bool_t IsSeekable() const override;
+
+        uint64_t GetPosition() override;
+
+        void SetPosition(uint64_t value) override;
+
+        uint64_t GetLength() override;
+
+        void SetLength(uint64_t value) override;
+
+        void Flush() override;
+
+        IStream *GetBaseStream() const;
+
+        uint64_t GetOffset() const;
+
+    private:
+
+        IStream *_baseStream;
+        uint64_t _offset;
+        uint64_t _length;
+        uint64_t _position;
+        bool_t _disposeBaseStream;
+
+    };
+
+CGSS_NS_END